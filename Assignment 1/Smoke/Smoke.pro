@@ -33,6 +33,10 @@ SOURCES += \
         mainwindow_scalardata.cpp \
         mainwindow_isolines.cpp \
         isoline.cpp \
+        marchingsquares.cpp \
+        convolution.cpp \
+        quantization.cpp \
+        spacetimevolume.cpp \
         mainwindow_heightplot.cpp
 
 HEADERS += \
@@ -46,8 +50,15 @@ HEADERS += \
         legend.h \
         legendscalardata.h \
         movingaverage.h \
+        movingminmax.h \
         fftwf_malloc_allocator.h \
         isoline.h \
+        marchingsquares.h \
+        convolution.h \
+        quantization.h \
+        spacetimevolume.h \
+        parallel.h \
+        simd.h \
         constants.h
 
 FORMS += \
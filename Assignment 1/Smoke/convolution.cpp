@@ -0,0 +1,500 @@
+#include "convolution.h"
+
+#include "parallel.h"
+#include "simd.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+    // Value of a single output position of which some taps fall outside [0, size).
+    // Only used for the (at most r wide) borders, so the bounds check is not in the hot loop.
+    float borderValue(float const *line, size_t const stride, size_t const size, size_t const position,
+                      float const *taps, size_t const numberOfTaps, convolution::Border const border)
+    {
+        size_t const radius = numberOfTaps / 2U;
+
+        float sum = 0.0F;
+        float weight = 0.0F;
+        for (size_t k = 0U; k < numberOfTaps; ++k)
+        {
+            // Unsigned wrap-around makes negative positions large, so a single comparison suffices.
+            size_t const sourcePosition = position + k - radius;
+            if (sourcePosition < size)
+            {
+                sum += taps[k] * line[sourcePosition * stride];
+                weight += taps[k];
+            }
+        }
+
+        return border == convolution::Border::Renormalize ? sum / weight : sum;
+    }
+
+#ifdef SIMD_AVX2
+    // Interior outputs of a row from x on, eight at a time. Returns the first output left for the scalar loop.
+    SIMD_AVX2_TARGET size_t filterRowAvx2(float const *input, float *output, size_t x, size_t const interiorEnd,
+                                          float const *taps, size_t const numberOfTaps)
+    {
+        size_t const radius = numberOfTaps / 2U;
+        for (; x + 8U <= interiorEnd; x += 8U)
+        {
+            float const *window = input + x - radius;
+            __m256 sum = _mm256_setzero_ps();
+            for (size_t k = 0U; k < numberOfTaps; ++k)
+                sum = _mm256_fmadd_ps(_mm256_set1_ps(taps[k]), _mm256_loadu_ps(window + k), sum);
+            _mm256_storeu_ps(output + x, sum);
+        }
+        return x;
+    }
+
+    // Outputs of a row of the column pass from x = 0 on, eight at a time. Returns the first output left for the scalar loop.
+    SIMD_AVX2_TARGET size_t filterColumnsAvx2(float const *firstSourceRow, float *outputRow, size_t const width,
+                                              float const *taps, size_t const kBegin, size_t const kEnd)
+    {
+        size_t x = 0U;
+        for (; x + 8U <= width; x += 8U)
+        {
+            __m256 sum = _mm256_setzero_ps();
+            float const *source = firstSourceRow + x;
+            for (size_t k = kBegin; k < kEnd; ++k, source += width)
+                sum = _mm256_fmadd_ps(_mm256_set1_ps(taps[k]), _mm256_loadu_ps(source), sum);
+            _mm256_storeu_ps(outputRow + x, sum);
+        }
+        return x;
+    }
+#endif
+
+    void filterRow(float const *input, float *output, size_t const width, float const *taps, size_t const numberOfTaps,
+                   convolution::Border const border)
+    {
+        size_t const radius = numberOfTaps / 2U;
+        size_t const interiorBegin = std::min(radius, width);
+        size_t const interiorEnd = width > radius ? std::max(interiorBegin, width - radius) : interiorBegin;
+
+        for (size_t x = 0U; x < interiorBegin; ++x)
+            output[x] = borderValue(input, 1U, width, x, taps, numberOfTaps, border);
+
+        // Interior: every tap lies inside the row.
+        size_t x = interiorBegin;
+#ifdef SIMD_AVX2
+        if (simd::hasAvx2())
+            x = filterRowAvx2(input, output, x, interiorEnd, taps, numberOfTaps);
+#endif
+        for (; x < interiorEnd; ++x)
+        {
+            float const *window = input + x - radius;
+            float sum = 0.0F;
+            for (size_t k = 0U; k < numberOfTaps; ++k)
+                sum += taps[k] * window[k];
+            output[x] = sum;
+        }
+
+        for (x = interiorEnd; x < width; ++x)
+            output[x] = borderValue(input, 1U, width, x, taps, numberOfTaps, border);
+    }
+
+    // Filters output row y along the columns. The taps that fall outside the field are
+    // determined once per row, so the loop over x is free of bounds checks.
+    void filterColumns(float const *input, float *output, size_t const width, size_t const height, size_t const y,
+                       float const *taps, size_t const numberOfTaps, convolution::Border const border)
+    {
+        size_t const radius = numberOfTaps / 2U;
+        size_t const kBegin = y < radius ? radius - y : 0U;
+        size_t const kEnd = std::min(numberOfTaps, height + radius - y);
+
+        float *outputRow = output + y * width;
+        float const *firstSourceRow = input + (y + kBegin - radius) * width;
+
+        size_t x = 0U;
+#ifdef SIMD_AVX2
+        if (simd::hasAvx2())
+            x = filterColumnsAvx2(firstSourceRow, outputRow, width, taps, kBegin, kEnd);
+#endif
+        for (; x < width; ++x)
+        {
+            float sum = 0.0F;
+            float const *source = firstSourceRow + x;
+            for (size_t k = kBegin; k < kEnd; ++k, source += width)
+                sum += taps[k] * *source;
+            outputRow[x] = sum;
+        }
+
+        // Near the top and bottom only the taps [kBegin, kEnd) lie inside the field.
+        if (border == convolution::Border::Renormalize && (kBegin > 0U || kEnd < numberOfTaps))
+        {
+            float weight = 0.0F;
+            for (size_t k = kBegin; k < kEnd; ++k)
+                weight += taps[k];
+            for (x = 0U; x < width; ++x)
+                outputRow[x] /= weight;
+        }
+    }
+
+    size_t const numberOfBoxes = 3U;
+
+    // Radii of the boxes whose cascade has the variance sigma^2 of the Gaussian as closely as possible
+    // (Kovesi, "Fast almost-Gaussian filtering"): m boxes of odd width wl and the others of width wl + 2.
+    std::array<size_t, numberOfBoxes> boxRadii(float const sigma)
+    {
+        float const n = static_cast<float>(numberOfBoxes);
+        float const idealWidth = std::sqrt(12.0F * sigma * sigma / n + 1.0F);
+
+        int lowerWidth = static_cast<int>(std::floor(idealWidth));
+        if (lowerWidth % 2 == 0)
+            --lowerWidth;
+        float const wl = static_cast<float>(lowerWidth);
+        long const m = std::lround((12.0F * sigma * sigma - n * wl * wl - 4.0F * n * wl - 3.0F * n) / (-4.0F * wl - 4.0F));
+
+        std::array<size_t, numberOfBoxes> radii;
+        for (size_t idx = 0U; idx < numberOfBoxes; ++idx)
+            radii[idx] = static_cast<size_t>(static_cast<long>(idx) < m ? lowerWidth / 2 : lowerWidth / 2 + 1);
+
+        return radii;
+    }
+
+    // Number of positions of [position - radius, position + radius] that lie inside [0, size).
+    size_t boxCount(size_t const position, size_t const radius, size_t const size)
+    {
+        size_t const first = position > radius ? position - radius : 0U;
+        size_t const last = std::min(position + radius, size - 1U);
+        return last - first + 1U;
+    }
+
+    // Running sum box filter along a row of size values: the sum is updated with one value
+    // entering and one leaving the box per step.
+    void boxRow(float const *input, float *output, size_t const size, size_t const radius)
+    {
+        float sum = 0.0F;
+        for (size_t x = 0U; x <= radius && x < size; ++x)
+            sum += input[x];
+
+        // Left border: the box is clipped and only gains values.
+        size_t x = 0U;
+        for (; x < size && (x < radius || x + radius + 1U >= size); ++x)
+        {
+            output[x] = sum / static_cast<float>(boxCount(x, radius, size));
+
+            if (x + radius + 1U < size)
+                sum += input[x + radius + 1U];
+            if (x >= radius)
+                sum -= input[x - radius];
+        }
+
+        // Interior: the box lies inside the row, so its size is constant.
+        float const reciprocalCount = 1.0F / static_cast<float>(2U * radius + 1U);
+        for (; x + radius + 1U < size; ++x)
+        {
+            output[x] = sum * reciprocalCount;
+            sum += input[x + radius + 1U] - input[x - radius];
+        }
+
+        // Right border: the box is clipped and only loses values.
+        for (; x < size; ++x)
+        {
+            output[x] = sum / static_cast<float>(boxCount(x, radius, size));
+            sum -= input[x - radius];
+        }
+    }
+
+    // Running sum box filter along the columns [columnBegin, columnEnd). The sums of a whole row segment
+    // are updated at once, which vectorizes and walks the field row by row.
+    void boxColumns(float const *input, float *output, size_t const width, size_t const height,
+                    size_t const columnBegin, size_t const columnEnd, size_t const radius, float *sums)
+    {
+        size_t const numberOfColumns = columnEnd - columnBegin;
+        input += columnBegin;
+        output += columnBegin;
+
+        std::fill(sums, sums + numberOfColumns, 0.0F);
+        for (size_t y = 0U; y <= radius && y < height; ++y)
+            for (size_t x = 0U; x < numberOfColumns; ++x)
+                sums[x] += input[x + width * y];
+
+        for (size_t y = 0U; y < height; ++y)
+        {
+            float const reciprocalCount = 1.0F / static_cast<float>(boxCount(y, radius, height));
+            for (size_t x = 0U; x < numberOfColumns; ++x)
+                output[x + width * y] = sums[x] * reciprocalCount;
+
+            if (y + radius + 1U < height)
+            {
+                float const *entering = input + width * (y + radius + 1U);
+                for (size_t x = 0U; x < numberOfColumns; ++x)
+                    sums[x] += entering[x];
+            }
+            if (y >= radius)
+            {
+                float const *leaving = input + width * (y - radius);
+                for (size_t x = 0U; x < numberOfColumns; ++x)
+                    sums[x] -= leaving[x];
+            }
+        }
+    }
+
+    // Coefficients of the minimax polynomial for atan(a) on [0, 1] used by fastAtan2().
+    float const atanC1 = 0.99997726F;
+    float const atanC3 = -0.33262347F;
+    float const atanC5 = 0.19354346F;
+    float const atanC7 = -0.11643287F;
+    float const atanC9 = 0.05265332F;
+    float const atanC11 = -0.01172120F;
+
+    float const halfPi = 1.5707963F;
+    float const pi = 3.1415927F;
+
+#ifdef SIMD_AVX2
+    // Eight fastAtan2() evaluations at once.
+    SIMD_AVX2_TARGET __m256 fastAtan2x8(__m256 const y, __m256 const x)
+    {
+        __m256 const signMask = _mm256_set1_ps(-0.0F);
+        __m256 const absY = _mm256_andnot_ps(signMask, y);
+        __m256 const absX = _mm256_andnot_ps(signMask, x);
+
+        // Reduce to a = min / max in [0, 1]; max(.., FLT_MIN) maps (0, 0) to 0 instead of NaN.
+        __m256 const a = _mm256_div_ps(_mm256_min_ps(absX, absY),
+                                       _mm256_max_ps(_mm256_max_ps(absX, absY), _mm256_set1_ps(1.17549435e-38F)));
+        __m256 const s = _mm256_mul_ps(a, a);
+
+        __m256 r = _mm256_set1_ps(atanC11);
+        r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(atanC9));
+        r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(atanC7));
+        r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(atanC5));
+        r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(atanC3));
+        r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(atanC1));
+        r = _mm256_mul_ps(r, a);
+
+        // Undo the reduction: swap octants, mirror for negative x, then copy the sign of y.
+        r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(halfPi), r), _mm256_cmp_ps(absY, absX, _CMP_GT_OQ));
+        r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(pi), r), x);
+        return _mm256_or_ps(r, _mm256_and_ps(y, signMask));
+    }
+
+    // Interior outputs of row y from x = 1 on, eight at a time. Returns the first output left for the scalar loop.
+    SIMD_AVX2_TARGET size_t sobelRowAvx2(float const *below, float const *row, float const *above, float *magnitude,
+                                         float *direction, size_t const width, size_t const y)
+    {
+        size_t x = 1U;
+        __m256 const two = _mm256_set1_ps(2.0F);
+        for (; x + 8U <= width - 1U; x += 8U)
+        {
+            __m256 const belowLeft  = _mm256_loadu_ps(below + x - 1U);
+            __m256 const belowMid   = _mm256_loadu_ps(below + x);
+            __m256 const belowRight = _mm256_loadu_ps(below + x + 1U);
+            __m256 const rowLeft    = _mm256_loadu_ps(row + x - 1U);
+            __m256 const rowRight   = _mm256_loadu_ps(row + x + 1U);
+            __m256 const aboveLeft  = _mm256_loadu_ps(above + x - 1U);
+            __m256 const aboveMid   = _mm256_loadu_ps(above + x);
+            __m256 const aboveRight = _mm256_loadu_ps(above + x + 1U);
+
+            __m256 const gxVec = _mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(belowRight, belowLeft),
+                                                             _mm256_sub_ps(aboveRight, aboveLeft)),
+                                               _mm256_mul_ps(two, _mm256_sub_ps(rowRight, rowLeft)));
+            __m256 const gyVec = _mm256_sub_ps(_mm256_fmadd_ps(two, aboveMid, _mm256_add_ps(aboveLeft, aboveRight)),
+                                               _mm256_fmadd_ps(two, belowMid, _mm256_add_ps(belowLeft, belowRight)));
+
+            size_t const idx = x + width * y;
+            if (magnitude != nullptr)
+                _mm256_storeu_ps(magnitude + idx, _mm256_sqrt_ps(_mm256_fmadd_ps(gxVec, gxVec, _mm256_mul_ps(gyVec, gyVec))));
+            if (direction != nullptr)
+                _mm256_storeu_ps(direction + idx, fastAtan2x8(gyVec, gxVec));
+        }
+        return x;
+    }
+#endif
+
+    // Value at (x, y), or zero outside the field.
+    float valueOrZero(float const *input, size_t const width, size_t const height, size_t const x, size_t const y)
+    {
+        return (x < width && y < height) ? input[x + width * y] : 0.0F;
+    }
+
+    // Sobel gradient at a border position; neighbors outside the field count as zero.
+    void sobelAtBorder(float const *input, size_t const width, size_t const height, size_t const x, size_t const y,
+                       float &gx, float &gy)
+    {
+        // Unsigned wrap-around turns x - 1 at x == 0 into an out-of-field position.
+        auto const v = [&](size_t const i, size_t const j) { return valueOrZero(input, width, height, i, j); };
+
+        gx = (v(x + 1U, y - 1U) - v(x - 1U, y - 1U))
+           + 2.0F * (v(x + 1U, y) - v(x - 1U, y))
+           + (v(x + 1U, y + 1U) - v(x - 1U, y + 1U));
+        gy = (v(x - 1U, y + 1U) + 2.0F * v(x, y + 1U) + v(x + 1U, y + 1U))
+           - (v(x - 1U, y - 1U) + 2.0F * v(x, y - 1U) + v(x + 1U, y - 1U));
+    }
+
+    void storeGradient(float const gx, float const gy, float *magnitude, float *direction, size_t const idx)
+    {
+        if (magnitude != nullptr)
+            magnitude[idx] = std::sqrt(gx * gx + gy * gy);
+        if (direction != nullptr)
+            direction[idx] = convolution::fastAtan2(gy, gx);
+    }
+
+    void sobelRow(float const *input, float *magnitude, float *direction, size_t const width, size_t const height,
+                  size_t const y)
+    {
+        bool const borderRow = y == 0U || y + 1U >= height;
+        if (borderRow || width < 3U)
+        {
+            for (size_t x = 0U; x < width; ++x)
+            {
+                float gx, gy;
+                sobelAtBorder(input, width, height, x, y, gx, gy);
+                storeGradient(gx, gy, magnitude, direction, x + width * y);
+            }
+            return;
+        }
+
+        float const *below = input + width * (y - 1U);
+        float const *row = input + width * y;
+        float const *above = input + width * (y + 1U);
+
+        float gx, gy;
+        sobelAtBorder(input, width, height, 0U, y, gx, gy);
+        storeGradient(gx, gy, magnitude, direction, width * y);
+
+        // Interior: the whole 3x3 neighborhood lies inside the field.
+        size_t x = 1U;
+#ifdef SIMD_AVX2
+        if (simd::hasAvx2())
+            x = sobelRowAvx2(below, row, above, magnitude, direction, width, y);
+#endif
+        for (; x < width - 1U; ++x)
+        {
+            gx = (below[x + 1U] - below[x - 1U]) + 2.0F * (row[x + 1U] - row[x - 1U]) + (above[x + 1U] - above[x - 1U]);
+            gy = (above[x - 1U] + 2.0F * above[x] + above[x + 1U]) - (below[x - 1U] + 2.0F * below[x] + below[x + 1U]);
+            storeGradient(gx, gy, magnitude, direction, x + width * y);
+        }
+
+        sobelAtBorder(input, width, height, width - 1U, y, gx, gy);
+        storeGradient(gx, gy, magnitude, direction, width - 1U + width * y);
+    }
+}
+
+namespace convolution
+{
+    std::vector<float> gaussianKernel(size_t const radius, float const sigma)
+    {
+        Q_ASSERT(sigma > 0.0F);
+
+        std::vector<float> taps(2U * radius + 1U);
+        float sum = 0.0F;
+        for (size_t k = 0U; k < taps.size(); ++k)
+        {
+            float const offset = static_cast<float>(k) - static_cast<float>(radius);
+            taps[k] = std::exp(-offset * offset / (2.0F * sigma * sigma));
+            sum += taps[k];
+        }
+
+        for (auto &tap : taps)
+            tap /= sum;
+
+        return taps;
+    }
+
+    void rowPass(float const *input, float *output, size_t const width, size_t const height,
+                 std::vector<float> const &kernel, Border const border)
+    {
+        Q_ASSERT(kernel.size() % 2U == 1U);
+        Q_ASSERT(input != output);
+
+        parallel::forRowBands(height, width * kernel.size(), [&](size_t const rowBegin, size_t const rowEnd)
+        {
+            for (size_t y = rowBegin; y < rowEnd; ++y)
+                filterRow(input + y * width, output + y * width, width, kernel.data(), kernel.size(), border);
+        });
+    }
+
+    void columnPass(float const *input, float *output, size_t const width, size_t const height,
+                    std::vector<float> const &kernel, Border const border)
+    {
+        Q_ASSERT(kernel.size() % 2U == 1U);
+        Q_ASSERT(input != output);
+
+        parallel::forRowBands(height, width * kernel.size(), [&](size_t const rowBegin, size_t const rowEnd)
+        {
+            for (size_t y = rowBegin; y < rowEnd; ++y)
+                filterColumns(input, output, width, height, y, kernel.data(), kernel.size(), border);
+        });
+    }
+
+    void separable(float const *input, float *output, float *scratch, size_t const width, size_t const height,
+                   std::vector<float> const &kernelX, std::vector<float> const &kernelY, Border const border)
+    {
+        rowPass(input, scratch, width, height, kernelX, border);
+        columnPass(scratch, output, width, height, kernelY, border);
+    }
+
+    void boxCascade(float const *input, float *output, float *scratch, float *columnSums, size_t const width,
+                    size_t const height, float const sigma)
+    {
+        Q_ASSERT(sigma > 0.0F);
+        Q_ASSERT(scratch != input && scratch != output);
+
+        std::array<size_t, numberOfBoxes> const radii = boxRadii(sigma);
+
+        // Every pass only touches the rows (or columns) of its own band, and a pass starts after the previous
+        // one has finished, so ping-ponging between output and scratch is safe even when input == output.
+        // The passes are input -> scratch -> output -> scratch along x, then scratch -> output -> scratch -> output along y.
+        float const *source = input;
+        float *destination = scratch;
+        for (size_t const radius : radii)
+        {
+            parallel::forRowBands(height, 2U * width, [&](size_t const rowBegin, size_t const rowEnd)
+            {
+                for (size_t y = rowBegin; y < rowEnd; ++y)
+                    boxRow(source + width * y, destination + width * y, width, radius);
+            });
+
+            source = destination;
+            destination = destination == scratch ? output : scratch;
+        }
+
+        for (size_t const radius : radii)
+        {
+            // Bands of columns instead of rows, so every thread keeps the running sums of its own columns.
+            parallel::forRowBands(width, 3U * height, [&](size_t const columnBegin, size_t const columnEnd)
+            {
+                boxColumns(source, destination, width, height, columnBegin, columnEnd, radius, columnSums + columnBegin);
+            });
+
+            source = destination;
+            destination = destination == scratch ? output : scratch;
+        }
+    }
+
+    void sobel(float const *input, float *magnitude, float *direction, size_t const width, size_t const height)
+    {
+        Q_ASSERT(input != magnitude && input != direction);
+
+        parallel::forRowBands(height, 9U * width, [&](size_t const rowBegin, size_t const rowEnd)
+        {
+            for (size_t y = rowBegin; y < rowEnd; ++y)
+                sobelRow(input, magnitude, direction, width, height, y);
+        });
+    }
+
+    float fastAtan2(float const y, float const x)
+    {
+        float const absY = std::fabs(y);
+        float const absX = std::fabs(x);
+
+        // Reduce to a = min / max in [0, 1]; max(.., FLT_MIN) maps (0, 0) to 0 instead of NaN.
+        float const a = std::min(absX, absY) / std::max(std::max(absX, absY), 1.17549435e-38F);
+        float const s = a * a;
+
+        float r = ((((atanC11 * s + atanC9) * s + atanC7) * s + atanC5) * s + atanC3) * s + atanC1;
+        r *= a;
+
+        // Undo the reduction: swap octants, mirror for negative x, then copy the sign of y.
+        if (absY > absX)
+            r = halfPi - r;
+        if (std::signbit(x))
+            r = pi - r;
+        return std::copysign(r, y);
+    }
+}
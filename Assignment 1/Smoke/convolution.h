@@ -0,0 +1,72 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <cstddef>
+#include <vector>
+
+/* Separable 2D convolution on row-major width x height fields.
+ *
+ * A 2D kernel that is the outer product of a horizontal and a vertical 1D kernel is applied as a row pass
+ * followed by a column pass, which costs 2 * (2r + 1) instead of (2r + 1)^2 operations per value.
+ * Both the Gaussian and the Sobel kernels are separable.
+ *
+ * Kernels have an odd number of taps; tap k is applied to the value at offset k - r, with radius r = taps.size() / 2.
+ * Like the original 3x3 convolution, values outside the field are treated as zero, unless Border::Renormalize is given.
+ * Each pass splits a row into border and interior parts, so the interior loop is free of bounds checks,
+ * and rows are divided over threads.
+ */
+namespace convolution
+{
+    // Taps of the 3x3 binomial approximation of a Gaussian (outer product gives 1/16 [1 2 1; 2 4 2; 1 2 1]).
+    std::vector<float> const binomialKernel{0.25F, 0.5F, 0.25F};
+
+    // The two 1D factors of the Sobel operator.
+    std::vector<float> const sobelSmoothingKernel{1.0F, 2.0F, 1.0F};
+    std::vector<float> const sobelDerivativeKernel{1.0F, 0.0F, -1.0F};
+
+    // How the kernel passes treat the taps that fall outside the field.
+    enum class Border
+    {
+        Zero,       // Values outside the field count as zero.
+        Renormalize // Those taps are left out and the sum is divided by the sum of the others. For averaging kernels,
+                    // whose taps are positive and sum to one, so borders keep their level instead of fading to zero.
+    };
+
+    // Normalized Gaussian taps with the given radius.
+    std::vector<float> gaussianKernel(size_t const radius, float const sigma);
+
+    // Filters along x: output[x, y] = sum_k kernel[k] * input[x + k - r, y].
+    void rowPass(float const *input, float *output, size_t const width, size_t const height,
+                 std::vector<float> const &kernel, Border const border = Border::Zero);
+
+    // Filters along y: output[x, y] = sum_k kernel[k] * input[x, y + k - r].
+    void columnPass(float const *input, float *output, size_t const width, size_t const height,
+                    std::vector<float> const &kernel, Border const border = Border::Zero);
+
+    // Row pass with kernelX into scratch, then column pass with kernelY into output.
+    // Input and output may be the same buffer; scratch must hold width * height values and differ from both.
+    void separable(float const *input, float *output, float *scratch, size_t const width, size_t const height,
+                   std::vector<float> const &kernelX, std::vector<float> const &kernelY, Border const border = Border::Zero);
+
+    /* Gaussian blur with standard deviation sigma (in cells) approximated by three successive box filters per axis,
+     * whose widths are chosen to match sigma. Running sums make the cost per value independent of sigma.
+     * A box averages only the values inside the field, the border rule of Border::Renormalize, so borders keep their
+     * level instead of fading to zero, which matters once the boxes are as wide as the field.
+     * Input and output may be the same buffer; scratch must hold width * height values and differ from both.
+     * columnSums must hold width values; it keeps the running sums of the column passes.
+     */
+    void boxCascade(float const *input, float *output, float *scratch, float *columnSums, size_t const width,
+                    size_t const height, float const sigma);
+
+    /* Fused Sobel operator: reads each 3x3 neighborhood once and writes the gradient magnitude
+     * sqrt(gx^2 + gy^2) and the gradient direction atan2(gy, gx) in [-pi, pi].
+     * gx and gy are the derivatives along increasing x and y.
+     * Either output may be nullptr when it is not needed; neither may alias the input.
+     */
+    void sobel(float const *input, float *magnitude, float *direction, size_t const width, size_t const height);
+
+    // Polynomial approximation of std::atan2 with an absolute error below 2.1e-6 radians. Returns 0 for (0, 0).
+    float fastAtan2(float const y, float const x);
+}
+
+#endif // CONVOLUTION_H
@@ -1,4 +1,7 @@
 #include "isoline.h"
+
+#include "marchingsquares.h"
+
 #include <iostream>
 #include <QDebug>
 
@@ -26,35 +29,57 @@ Isoline::Isoline(std::vector<float> const &values,
 }
 
 
-void Isoline::marchingSquaresNonInterpolated()
+// Classifies every value, including the last row and column, which the top and right corners of the cells read.
+void Isoline::classify()
 {
-    std::vector<bool> binary;
-    binary.reserve(m_values.size());
+    m_wordsPerRow = MarchingSquares::wordsPerRow(m_DIM);
+    m_above.resize(m_wordsPerRow * m_DIM);
 
-    // Create binary matrix based on m_isolinesRho
-    for (size_t j = 0U; j < (m_DIM - 1U); ++j)
+    for (size_t j = 0U; j < m_DIM; ++j)
+        MarchingSquares::classifyRow(m_values.data() + m_DIM * j, m_DIM, m_isolineRho, m_above.data() + m_wordsPerRow * j);
+}
+
+// Case of the cell with bottom left corner (i, j): bit n is set when corner vn is above rho.
+size_t Isoline::tableIdx(size_t const i, size_t const j) const
+{
+    auto const above = [&](size_t const x, size_t const y) -> size_t
     {
-        for (size_t i = 0U; i < (m_DIM - 1U); ++i)
-        {
-            binary[i + m_DIM * j] = m_values[i + m_DIM * j] > m_isolineRho;
-        }
-    }
+        return (m_above[m_wordsPerRow * y + x / 64U] >> (x % 64U)) & 1U;
+    };
+
+    return above(i, j)                      // v0, bottom left
+         | above(i + 1U, j) << 1U           // v1, bottom right
+         | above(i + 1U, j + 1U) << 2U      // v2, top right
+         | above(i, j + 1U) << 3U;          // v3, top left
+}
+
+// Asymptotic decider for the ambiguous cases 5 and 10. The corners above rho are connected through the cell when
+// the saddle value of the bilinear interpolant is above rho, which is when the corner offsets from rho satisfy
+// (v0 - rho)(v2 - rho) > (v1 - rho)(v3 - rho) in case 5, or the reverse in case 10. Case 5 separates v0 and v2
+// and case 10 separates v1 and v3, so the result picks the case with the right segments for either.
+size_t Isoline::resolveSaddle(size_t const tableIdx, size_t const i, size_t const j) const
+{
+    if (tableIdx != 5U && tableIdx != 10U)
+        return tableIdx;
+
+    float const v0 = m_values[i + m_DIM * j] - m_isolineRho;
+    float const v1 = m_values[(i + 1U) + m_DIM * j] - m_isolineRho;
+    float const v2 = m_values[(i + 1U) + m_DIM * (j + 1U)] - m_isolineRho;
+    float const v3 = m_values[i + m_DIM * (j + 1U)] - m_isolineRho;
+
+    return v0 * v2 > v1 * v3 ? 10U : 5U;
+}
+
+void Isoline::marchingSquaresNonInterpolated()
+{
+    classify();
 
     // Loop over the bottom left corner of each square
     for (size_t j = 0U; j < (m_DIM - 1U); ++j)
     {
         for (size_t i = 0U; i < (m_DIM - 1U); ++i)
         {
-            size_t tableIdx = (size_t) binary[i + m_DIM * (j+1)] << 1; // v3, top left
-            tableIdx = (tableIdx + (size_t) binary[(i+1) + m_DIM * (j+1)]) << 1; // v2, top right
-            tableIdx = (tableIdx + (size_t) binary[(i+1) + m_DIM * j]) << 1; // v1, bottom right
-            tableIdx = (tableIdx + (size_t) binary[i + m_DIM * j]); // v0, bottom left
-
-            // Asymptotic decider
-            if (tableIdx == 5 || tableIdx == 10) // Ambibuous cases
-            {
-                // TODO
-            }
+            size_t const tableIdx = resolveSaddle(Isoline::tableIdx(i, j), i, j);
 
             // For drawing offset the cells a little to the right and up to make it match the scalar field.
             QVector2D const bottomLeft{static_cast<float>(i + 1U) * m_cellSideLength,
@@ -67,17 +92,7 @@ void Isoline::marchingSquaresNonInterpolated()
 
 void Isoline::marchingSquaresInterpolated()
 {
-    std::vector<bool> binary;
-    binary.reserve(m_values.size());
-
-    // Create binary matrix based on m_isolinesRho
-    for (size_t j = 0U; j < (m_DIM - 1U); ++j)
-    {
-        for (size_t i = 0U; i < (m_DIM - 1U); ++i)
-        {
-            binary[i + m_DIM * j] = m_values[i + m_DIM * j] > m_isolineRho;
-        }
-    }
+    classify();
 
     // Loop over the bottom left corner of each square
     for (size_t j = 0U; j < (m_DIM - 1U); ++j)
@@ -91,7 +106,7 @@ void Isoline::marchingSquaresInterpolated()
             size_t const v2 = (i+1) + m_DIM * (j+1); // top right
             size_t const v3 = i + m_DIM * (j+1); // top left
 
-            size_t tableIdx = ((m_values[v3] > m_isolineRho) << 3) + ((m_values[v2] > m_isolineRho) << 2) + ((m_values[v1] > m_isolineRho) << 1) + (m_values[v0] > m_isolineRho);
+            size_t const tableIdx = resolveSaddle(Isoline::tableIdx(i, j), i, j);
 
             // For drawing offset the cells a little to the right and up to make it match the scalar field.
             QVector2D const bottomLeft{static_cast<float>(i + 1U) * m_cellSideLength,
@@ -102,7 +117,7 @@ void Isoline::marchingSquaresInterpolated()
     }
 }
 
-std::vector<QVector2D> Isoline::vertices() const
+std::vector<QVector2D> const &Isoline::vertices() const
 {
     return m_vertices;
 }
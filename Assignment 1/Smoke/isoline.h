@@ -4,6 +4,7 @@
 #include <QVector2D>
 
 #include <array>
+#include <cstdint>
 #include <functional>
 #include <optional>
 #include <vector>
@@ -19,6 +20,14 @@ class Isoline
     float const m_cellSideLength;
     QVector2D const m_vertex0;
 
+    // Packed classification of all values, m_wordsPerRow words per row: a bit is set when the value is above rho.
+    std::vector<uint64_t> m_above;
+    size_t m_wordsPerRow = 0U;
+
+    void classify();
+    size_t tableIdx(size_t const i, size_t const j) const;
+    size_t resolveSaddle(size_t const tableIdx, size_t const i, size_t const j) const;
+
     // Marching squares functions.
     void marchingSquaresInterpolated();
     void marchingSquaresNonInterpolated();
@@ -114,7 +123,7 @@ public:
             float const cellSideLength,
             InterpolationMethod const interpolationMethod);
 
-    std::vector<QVector2D> vertices() const;
+    std::vector<QVector2D> const &vertices() const;
 };
 
 #endif // ISOLINE_H
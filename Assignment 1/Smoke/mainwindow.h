@@ -44,12 +44,18 @@ private slots:
     // Simulation, run simulation.
     void on_pausePlayButton_clicked();
 
-    // Preprocessing
-    void on_quantizationCheckBox_toggled(bool checked);
+    // Preprocessing, pipeline of stages.
+    void on_preprocessingAddStagePushButton_clicked();
+    void on_preprocessingRemoveStagePushButton_clicked();
+    void on_preprocessingMoveStageUpPushButton_clicked();
+    void on_preprocessingMoveStageDownPushButton_clicked();
+    void on_preprocessingClearPushButton_clicked();
+
+    // Preprocessing, stage parameters.
     void on_quantizationBitsComboBox_currentIndexChanged(int index);
-
-    void on_gaussianBlurCheckBox_toggled(bool checked);
-    void on_gradientsCheckBox_toggled(bool checked);
+    void on_quantizationLevelsTextureCheckBox_toggled(bool checked);
+    void on_gaussianBlurSigmaDoubleSpinBox_valueChanged(double value);
+    void on_gradientsOutputComboBox_currentIndexChanged(int index);
 
     // Scalar data, draw true/false.
     void on_scalarDataDrawScalarDataCheckBox_toggled(bool checked);
@@ -57,12 +63,15 @@ private slots:
     // Scalar data, data type.
     void on_scalarDataComboBox_currentIndexChanged(int index);
 
-    // Scalar data, slicing on/off and parameters
-    void on_scalarDataslicingEnableCheckBox_toggled(bool checked);
+    // Scalar data, slicing parameters
     void on_scalarDataSlicingDirectionXRadioButton_toggled(bool checked);
     void on_scalarDataSlicingDirectionYRadioButton_toggled(bool checked);
     void on_scalarDataSlicingDirectionTRadioButton_toggled(bool checked);
+    void on_scalarDataSlicingDirectionObliqueRadioButton_toggled(bool checked);
     void on_scalarDataSlicingSliceIndexSpinBox_valueChanged(int arg1);
+    void on_scalarDataSlicingWindowLengthSpinBox_valueChanged(int value);
+    void on_scalarDataSlicingObliqueAngleSpinBox_valueChanged(int value);
+    void on_scalarDataSlicingGpuCheckBox_toggled(bool checked);
 
     // Scalar data, color map.
     void on_scalarDataColorMapComboBox_currentIndexChanged(int index);
@@ -77,6 +86,7 @@ private slots:
 
     // Scalar data, mapping, scaling.
     void on_scalarDataMappingScalingMovingAverageWindowSpinBox_valueChanged(int arg1);
+    void on_scalarDataMappingScalingSlidingExtremaCheckBox_toggled(bool checked);
 
     // Scalar data, mapping, clamping.
     void on_scalarDataMappingClampingMinSlider_valueChanged(int value);
@@ -92,9 +102,15 @@ private slots:
     // Isolines, draw on/off.
     void on_isolinesDrawIsolinesCheckBox_toggled(bool checked);
 
+    // Isolines, stitch segments into polylines or not.
+    void on_isolinesConnectSegmentsCheckBox_toggled(bool checked);
+
     // Isolines, color picker.
     void on_isolinesColorPickerButton_clicked();
 
+    // Isolines, single color or color map over the isovalues.
+    void on_isolinesColorMapComboBox_currentIndexChanged(int index);
+
     // Isolines, use same data as current scalar data or manually choose data.
     void on_isolinesUseCurrentScalarDataCheckBox_toggled(bool checked);
 
@@ -134,6 +150,7 @@ private slots:
     // Setters
     void setScalarDataMin(float const min);
     void setScalarDataMax(float const max);
+    void setPreprocessingStageTimings(std::vector<double> const &timings);
 
 
 private:
@@ -150,6 +167,8 @@ private:
     std::vector<Color> enumToColorMap(ColorMap const colorMap, size_t numberOfColors) const;
     void updateScalarDataColorMapGlobally() const;
     void updateVectorDataColorMapGlobally() const;
+    void updatePreprocessingPipeline(int const currentRow);
+    void updateSliceIndexRange();
 
     template <class T> T findChildSafe(QString const &widgetName) const;
 };
@@ -10,6 +10,14 @@ void MainWindow::on_isolinesDrawIsolinesCheckBox_toggled(bool checked)
     visualizationPtr->m_drawIsolines = checked;
 }
 
+// Isolines, draw segments or connected polylines.
+void MainWindow::on_isolinesConnectSegmentsCheckBox_toggled(bool checked)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_isolineOutputMode = checked ? MarchingSquares::OutputMode::Polylines
+                                                    : MarchingSquares::OutputMode::Segments;
+}
+
 // Isolines, color picker.
 void MainWindow::on_isolinesColorPickerButton_clicked()
 {
@@ -25,6 +33,34 @@ void MainWindow::on_isolinesColorPickerButton_clicked()
         qDebug() << "Color dialog did not return a valid color.";
 }
 
+// Isolines, color map. The first entry draws every isoline in the picked color.
+void MainWindow::on_isolinesColorMapComboBox_currentIndexChanged(int index)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_colorIsolinesByValue = index != 0;
+    ui->isolinesColorPickerButton->setDisabled(index != 0);
+
+    size_t const numberOfColors = 256U;
+    switch (index)
+    {
+        case 1:
+            visualizationPtr->loadIsolinesTexture(enumToColorMap(ColorMap::Grayscale, numberOfColors));
+        break;
+
+        case 2:
+            visualizationPtr->loadIsolinesTexture(enumToColorMap(ColorMap::Rainbow, numberOfColors));
+        break;
+
+        case 3:
+            visualizationPtr->loadIsolinesTexture(enumToColorMap(ColorMap::HeatMap, numberOfColors));
+        break;
+
+        case 4:
+            visualizationPtr->loadIsolinesTexture(enumToColorMap(ColorMap::BlueYellow, numberOfColors));
+        break;
+    }
+}
+
 // Isolines, pick data type manually or not.
 void MainWindow::on_isolinesUseCurrentScalarDataCheckBox_toggled(bool checked)
 {
@@ -95,7 +131,7 @@ void MainWindow::on_isolinesInterpolationMethodLinearRadioButton_toggled(bool ch
     if (checked)
     {
         auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
-        visualizationPtr->m_isolineInterpolationMethod = Isoline::InterpolationMethod::Linear;
+        visualizationPtr->m_isolineInterpolationMethod = MarchingSquares::InterpolationMethod::Linear;
     }
 }
 
@@ -104,6 +140,6 @@ void MainWindow::on_isolinesInterpolationMethodNoneRadioButton_toggled(bool chec
     if (checked)
     {
         auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
-        visualizationPtr->m_isolineInterpolationMethod = Isoline::InterpolationMethod::None;
+        visualizationPtr->m_isolineInterpolationMethod = MarchingSquares::InterpolationMethod::None;
     }
 }
@@ -1,17 +1,101 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
-void MainWindow::on_quantizationCheckBox_toggled(bool checked)
+#include <QString>
+
+#include <algorithm>
+#include <utility>
+
+// Pipeline functions. The indices of the stage combobox match the values of Visualization::PreprocessingStage.
+void MainWindow::on_preprocessingAddStagePushButton_clicked()
 {
     auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
-    openGLWidgetPtr->m_useQuantization = checked;
+    auto &stages = openGLWidgetPtr->m_preprocessingStages;
 
-    // When checked, send the current value of the spinbox to the backend by triggering it with
-    // its current index.
-    if (checked)
-        on_quantizationBitsComboBox_currentIndexChanged(ui->quantizationBitsComboBox->currentIndex());
+    stages.push_back(static_cast<Visualization::PreprocessingStage>(ui->preprocessingStageComboBox->currentIndex()));
+    updatePreprocessingPipeline(static_cast<int>(stages.size()) - 1);
+}
+
+void MainWindow::on_preprocessingRemoveStagePushButton_clicked()
+{
+    auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    auto &stages = openGLWidgetPtr->m_preprocessingStages;
+
+    int const row = ui->preprocessingPipelineListWidget->currentRow();
+    if (row < 0)
+        return;
+
+    stages.erase(stages.begin() + row);
+    updatePreprocessingPipeline(std::min(row, static_cast<int>(stages.size()) - 1));
+}
+
+void MainWindow::on_preprocessingMoveStageUpPushButton_clicked()
+{
+    auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    auto &stages = openGLWidgetPtr->m_preprocessingStages;
+
+    int const row = ui->preprocessingPipelineListWidget->currentRow();
+    if (row <= 0)
+        return;
+
+    std::swap(stages[static_cast<size_t>(row)], stages[static_cast<size_t>(row) - 1U]);
+    updatePreprocessingPipeline(row - 1);
+}
+
+void MainWindow::on_preprocessingMoveStageDownPushButton_clicked()
+{
+    auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    auto &stages = openGLWidgetPtr->m_preprocessingStages;
+
+    int const row = ui->preprocessingPipelineListWidget->currentRow();
+    if (row < 0 || row + 1 >= static_cast<int>(stages.size()))
+        return;
+
+    std::swap(stages[static_cast<size_t>(row)], stages[static_cast<size_t>(row) + 1U]);
+    updatePreprocessingPipeline(row + 1);
+}
+
+void MainWindow::on_preprocessingClearPushButton_clicked()
+{
+    auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    openGLWidgetPtr->m_preprocessingStages.clear();
+    updatePreprocessingPipeline(-1);
+}
+
+// Rebuilds the list of stages in the GUI and resets the timings, which no longer match the stages.
+void MainWindow::updatePreprocessingPipeline(int const currentRow)
+{
+    auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    auto const &stages = openGLWidgetPtr->m_preprocessingStages;
+    openGLWidgetPtr->m_preprocessingStageTimings.assign(stages.size(), 0.0);
+    // A (re)added quantization stage sets the clamping range again.
+    openGLWidgetPtr->m_quantizationClampedMaxLevel = 0U;
+    // Whether the GPU slices may have changed, and layers the CPU added to the window are not in the texture.
+    openGLWidgetPtr->m_spaceTimeVolumeTextureValid = false;
+
+    ui->preprocessingPipelineListWidget->clear();
+    for (auto const stage : stages)
+        ui->preprocessingPipelineListWidget->addItem(ui->preprocessingStageComboBox->itemText(static_cast<int>(stage)));
+    ui->preprocessingPipelineListWidget->setCurrentRow(currentRow);
+}
+
+// Shows the duration of each stage (in ms) next to its name.
+void MainWindow::setPreprocessingStageTimings(std::vector<double> const &timings)
+{
+    auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    auto const &stages = openGLWidgetPtr->m_preprocessingStages;
+    Q_ASSERT(timings.size() == stages.size());
+    Q_ASSERT(static_cast<int>(stages.size()) == ui->preprocessingPipelineListWidget->count());
+
+    for (size_t idx = 0U; idx < stages.size(); ++idx)
+    {
+        QString const name = ui->preprocessingStageComboBox->itemText(static_cast<int>(stages[idx]));
+        ui->preprocessingPipelineListWidget->item(static_cast<int>(idx))->setText(
+            QString("%1 (%2 ms)").arg(name).arg(timings[idx], 0, 'f', 2));
+    }
 }
 
+// Stage parameters.
 void MainWindow::on_quantizationBitsComboBox_currentIndexChanged(int index)
 {
     auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
@@ -20,22 +104,24 @@ void MainWindow::on_quantizationBitsComboBox_currentIndexChanged(int index)
     openGLWidgetPtr->m_quantizationBits = 1U << static_cast<unsigned int>(index);
 }
 
-void MainWindow::on_gaussianBlurCheckBox_toggled(bool checked)
+void MainWindow::on_quantizationLevelsTextureCheckBox_toggled(bool checked)
 {
     auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
-    openGLWidgetPtr->m_useGaussianBlur = checked;
+    openGLWidgetPtr->m_useLevelsTexture = checked;
 }
 
-void MainWindow::on_gradientsCheckBox_toggled(bool checked)
+void MainWindow::on_gaussianBlurSigmaDoubleSpinBox_valueChanged(double value)
 {
     auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
-    openGLWidgetPtr->m_useGradients = checked;
+    openGLWidgetPtr->m_gaussianBlurSigma = static_cast<float>(value);
 }
 
-void MainWindow::on_scalarDataslicingEnableCheckBox_toggled(bool checked)
+void MainWindow::on_gradientsOutputComboBox_currentIndexChanged(int index)
 {
+    // Index 0 maps to the gradient magnitude, index 1 to the gradient direction in [-pi, pi].
     auto const openGLWidgetPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
-    openGLWidgetPtr->m_useSlicing = checked;
+    openGLWidgetPtr->m_gradientOutput = index == 0 ? Visualization::GradientOutput::Magnitude
+                                                   : Visualization::GradientOutput::Direction;
 }
 
 void MainWindow::on_scalarDataSlicingDirectionXRadioButton_toggled(bool checked)
@@ -44,6 +130,7 @@ void MainWindow::on_scalarDataSlicingDirectionXRadioButton_toggled(bool checked)
     {
         auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
         visualizationPtr->m_slicingDirection = Visualization::SlicingDirection::x;
+        updateSliceIndexRange();
     }
 }
 
@@ -53,6 +140,7 @@ void MainWindow::on_scalarDataSlicingDirectionYRadioButton_toggled(bool checked)
     {
         auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
         visualizationPtr->m_slicingDirection = Visualization::SlicingDirection::y;
+        updateSliceIndexRange();
     }
 }
 
@@ -62,6 +150,17 @@ void MainWindow::on_scalarDataSlicingDirectionTRadioButton_toggled(bool checked)
     {
         auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
         visualizationPtr->m_slicingDirection = Visualization::SlicingDirection::t;
+        updateSliceIndexRange();
+    }
+}
+
+void MainWindow::on_scalarDataSlicingDirectionObliqueRadioButton_toggled(bool checked)
+{
+    if (checked)
+    {
+        auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+        visualizationPtr->m_slicingDirection = Visualization::SlicingDirection::oblique;
+        updateSliceIndexRange();
     }
 }
 
@@ -70,3 +169,39 @@ void MainWindow::on_scalarDataSlicingSliceIndexSpinBox_valueChanged(int arg1)
     auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
     visualizationPtr->m_sliceIdx = static_cast<size_t>(arg1);
 }
+
+void MainWindow::on_scalarDataSlicingWindowLengthSpinBox_valueChanged(int value)
+{
+    // The number of time steps in the slicing window, independent of the grid size. Resets the window.
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_spaceTimeVolume.resize(visualizationPtr->m_DIM, static_cast<size_t>(value));
+    visualizationPtr->m_spaceTimeVolumeTextureValid = false;
+    updateSliceIndexRange();
+}
+
+void MainWindow::on_scalarDataSlicingObliqueAngleSpinBox_valueChanged(int value)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_obliqueSliceAngle = static_cast<float>(value);
+}
+
+void MainWindow::on_scalarDataSlicingGpuCheckBox_toggled(bool checked)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_useGpuSlicing = checked;
+
+    // The texture did not follow the window while slicing on the CPU.
+    visualizationPtr->m_spaceTimeVolumeTextureValid = false;
+}
+
+// A t slice selects a time step of the window, the other slices a grid line.
+void MainWindow::updateSliceIndexRange()
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    size_t const numberOfSlices = visualizationPtr->m_slicingDirection == Visualization::SlicingDirection::t
+                                ? visualizationPtr->m_spaceTimeVolume.length()
+                                : visualizationPtr->m_DIM;
+
+    ui->scalarDataSlicingSliceIndexHorizontalSlider->setMaximum(static_cast<int>(numberOfSlices) - 1);
+    ui->scalarDataSlicingSliceIndexSpinBox->setMaximum(static_cast<int>(numberOfSlices) - 1);
+}
@@ -150,6 +150,13 @@ void MainWindow::on_scalarDataMappingScalingMovingAverageWindowSpinBox_valueChan
 {
     auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
     visualizationPtr->m_minMaxDensity.setWindowSize(static_cast<size_t>(arg1));
+    visualizationPtr->m_minMaxDensityExtrema.setWindowSize(static_cast<size_t>(arg1));
+}
+
+void MainWindow::on_scalarDataMappingScalingSlidingExtremaCheckBox_toggled(bool checked)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_useSlidingExtrema = checked;
 }
 
 
@@ -58,8 +58,7 @@ void MainWindow::on_gridpointsSpinBox_valueChanged(int value)
         auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
         visualizationPtr->setDIM(static_cast<size_t>(value));
 
-        ui->scalarDataSlicingSliceIndexHorizontalSlider->setMaximum(value - 1);
-        ui->scalarDataSlicingSliceIndexSpinBox->setMaximum(value - 1);
+        updateSliceIndexRange();
     }
     else
         qDebug() << "Size must be a multiple of 2";
@@ -0,0 +1,619 @@
+#include "marchingsquares.h"
+
+#include "parallel.h"
+#include "simd.h"
+
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    enum Edge : unsigned char
+    {
+        Bottom, // v0 -> v1
+        Right,  // v1 -> v2
+        Top,    // v3 -> v2
+        Left    // v0 -> v3
+    };
+
+    // The corners at the start and end of each edge, so a crossing lies at start + t * direction.
+    std::array<std::array<unsigned char, 2U>, 4U> const edgeCorners{{{0U, 1U}, {1U, 2U}, {3U, 2U}, {0U, 3U}}};
+    std::array<QVector2D, 4U> const edgeStart{QVector2D{0.0F, 0.0F}, QVector2D{1.0F, 0.0F},
+                                              QVector2D{0.0F, 1.0F}, QVector2D{0.0F, 0.0F}};
+    std::array<QVector2D, 4U> const edgeDirection{QVector2D{1.0F, 0.0F}, QVector2D{0.0F, 1.0F},
+                                                  QVector2D{1.0F, 0.0F}, QVector2D{0.0F, 1.0F}};
+
+    /* The crossed edges per case, two per segment.
+     *
+     * The table is indexed by case + 16 * d, where d is the asymptotic decider of the saddle cases 5 and 10. The bilinear
+     * interpolant has a saddle point inside the cell, and the corners above the isovalue are connected through the cell
+     * when the saddle value is above it. With the corner offsets ai = vi - isovalue, the saddle value (a0 a2 - a1 a3) /
+     * (a0 + a2 - a1 - a3) lies above the isovalue exactly when a0 a2 > a1 a3 in case 5, and a0 a2 < a1 a3 in case 10.
+     * So d = (a0 a2 > a1 a3) keeps the diagonal v0-v2 connected and cuts off v1 and v3, and d = 0 does the opposite,
+     * whichever corners are above. The other cases are the same in both halves, so d is computed without branching.
+     */
+    struct CaseEdges
+    {
+        unsigned char numberOfEdges;
+        std::array<Edge, 4U> edges;
+    };
+
+    std::array<CaseEdges, 32U> const caseEdges
+    {{
+        // v1-v3 diagonal connected in the saddle cases.
+        {0U, {}},                           // 0
+        {2U, {Bottom, Left}},               // 1
+        {2U, {Bottom, Right}},              // 2
+        {2U, {Left, Right}},                // 3
+        {2U, {Top, Right}},                 // 4
+        {4U, {Bottom, Left, Top, Right}},   // 5, cuts off v0 and v2
+        {2U, {Top, Bottom}},                // 6
+        {2U, {Top, Left}},                  // 7
+        {2U, {Top, Left}},                  // 8
+        {2U, {Top, Bottom}},                // 9
+        {4U, {Bottom, Left, Top, Right}},   // 10, cuts off v0 and v2
+        {2U, {Top, Right}},                 // 11
+        {2U, {Left, Right}},                // 12
+        {2U, {Bottom, Right}},              // 13
+        {2U, {Bottom, Left}},               // 14
+        {0U, {}},                           // 15
+
+        // v0-v2 diagonal connected in the saddle cases.
+        {0U, {}},                           // 0
+        {2U, {Bottom, Left}},               // 1
+        {2U, {Bottom, Right}},              // 2
+        {2U, {Left, Right}},                // 3
+        {2U, {Top, Right}},                 // 4
+        {4U, {Bottom, Right, Top, Left}},   // 5, cuts off v1 and v3
+        {2U, {Top, Bottom}},                // 6
+        {2U, {Top, Left}},                  // 7
+        {2U, {Top, Left}},                  // 8
+        {2U, {Top, Bottom}},                // 9
+        {4U, {Bottom, Right, Top, Left}},   // 10, cuts off v1 and v3
+        {2U, {Top, Right}},                 // 11
+        {2U, {Left, Right}},                // 12
+        {2U, {Bottom, Right}},              // 13
+        {2U, {Bottom, Left}},               // 14
+        {0U, {}}                            // 15
+    }};
+
+    // Blocks of the span-space index are one bitmask word wide and this many cell rows high.
+    size_t const blockWidth = 64U;
+    size_t const blockHeight = 8U;
+
+    // Crossings are linked through a table that holds the edges of this many value rows, which is enough for the
+    // rows of a block row and the row below it, so it stays small enough to be cached.
+    size_t const edgeTableRows = 2U * blockHeight;
+
+    uint32_t const none = std::numeric_limits<uint32_t>::max();
+
+    uint64_t bit(uint64_t const word, size_t const idx)
+    {
+        return (word >> idx) & 1U;
+    }
+
+#ifdef SIMD_AVX2
+    // classifyWord() for the first length / 8 * 8 values. Returns the number of values it covered.
+    SIMD_AVX2_TARGET size_t classifyWordAvx2(float const *values, size_t const length, float const isovalue, uint64_t &word)
+    {
+        // Each compare sets the sign bits of 8 lanes, which movemask packs into 8 bits.
+        __m256 const threshold = _mm256_set1_ps(isovalue);
+        size_t idx = 0U;
+        for (; idx + 8U <= length; idx += 8U)
+        {
+            __m256 const above = _mm256_cmp_ps(_mm256_loadu_ps(values + idx), threshold, _CMP_GT_OQ);
+            word |= static_cast<uint64_t>(static_cast<unsigned int>(_mm256_movemask_ps(above))) << idx;
+        }
+        return idx;
+    }
+
+    // extendRange() for the first length / 8 * 8 values (length >= 8). Returns the number of values it covered.
+    SIMD_AVX2_TARGET size_t extendRangeAvx2(float const *values, size_t const length, float &min, float &max)
+    {
+        __m256 minima = _mm256_set1_ps(min);
+        __m256 maxima = _mm256_set1_ps(max);
+        size_t idx = 0U;
+        for (; idx + 8U <= length; idx += 8U)
+        {
+            __m256 const lanes = _mm256_loadu_ps(values + idx);
+            minima = _mm256_min_ps(minima, lanes);
+            maxima = _mm256_max_ps(maxima, lanes);
+        }
+
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, minima);
+        min = *std::min_element(lanes, lanes + 8);
+        _mm256_store_ps(lanes, maxima);
+        max = *std::max_element(lanes, lanes + 8);
+        return idx;
+    }
+#endif
+
+    // Bit n is set when values[n] > isovalue, for the first length (at most 64) values.
+    uint64_t classifyWord(float const *values, size_t const length, float const isovalue)
+    {
+        uint64_t word = 0U;
+        size_t idx = 0U;
+#ifdef SIMD_AVX2
+        if (simd::hasAvx2())
+            idx = classifyWordAvx2(values, length, isovalue, word);
+#endif
+        for (; idx < length; ++idx)
+            word |= static_cast<uint64_t>(values[idx] > isovalue) << idx;
+
+        return word;
+    }
+
+    // Widens [min, max] to include the given values.
+    void extendRange(float const *values, size_t const length, float &min, float &max)
+    {
+        size_t idx = 0U;
+#ifdef SIMD_AVX2
+        if (length >= 8U && simd::hasAvx2())
+            idx = extendRangeAvx2(values, length, min, max);
+#endif
+        for (; idx < length; ++idx)
+        {
+            min = std::min(min, values[idx]);
+            max = std::max(max, values[idx]);
+        }
+    }
+}
+
+void MarchingSquares::classifyRow(float const *row, size_t const rowLength, float const isovalue, uint64_t *bits)
+{
+    for (size_t wordIdx = 0U; wordIdx < wordsPerRow(rowLength); ++wordIdx)
+        bits[wordIdx] = classifyWord(row + 64U * wordIdx, std::min<size_t>(64U, rowLength - 64U * wordIdx), isovalue);
+}
+
+void MarchingSquares::extract(std::vector<float> const &values, size_t const DIM, std::vector<float> const &isovalues,
+                              float const cellSideLength, InterpolationMethod const interpolationMethod,
+                              OutputMode const outputMode)
+{
+    Q_ASSERT(values.size() == DIM * DIM);
+    Q_ASSERT(std::is_sorted(isovalues.cbegin(), isovalues.cend()));
+
+    m_vertices.clear();
+    m_polylineOffsets.assign(1U, 0U);
+    if (DIM < 2U || isovalues.empty())
+        return;
+
+    if (outputMode == OutputMode::Segments)
+    {
+        switch (interpolationMethod)
+        {
+            case InterpolationMethod::Linear:
+                extractSegments<true>(values, DIM, isovalues, cellSideLength);
+            break;
+
+            case InterpolationMethod::None:
+                extractSegments<false>(values, DIM, isovalues, cellSideLength);
+            break;
+        }
+        return;
+    }
+
+    // Edge IDs run up to 2 * DIM * DIM.
+    Q_ASSERT(2U * DIM * DIM <= std::numeric_limits<uint32_t>::max());
+
+    m_isovalueOffsets.assign(isovalues.size() + 1U, 0U);
+
+    switch (interpolationMethod)
+    {
+        case InterpolationMethod::Linear:
+            extractCells<true>(values, DIM, isovalues, cellSideLength);
+        break;
+
+        case InterpolationMethod::None:
+            extractCells<false>(values, DIM, isovalues, cellSideLength);
+        break;
+    }
+
+    stitchPolylines(isovalues.size());
+}
+
+// Block (b, w) holds the cells in rows [b * blockHeight, (b + 1) * blockHeight) and columns [w * 64, (w + 1) * 64),
+// so its corner values are those in rows [b * blockHeight, (b + 1) * blockHeight] and columns [w * 64, (w + 1) * 64].
+void MarchingSquares::buildBlockIndex(std::vector<float> const &values, size_t const DIM)
+{
+    size_t const numberOfCells = DIM - 1U;
+    size_t const numberOfBlockColumns = wordsPerRow(numberOfCells);
+    size_t const numberOfBlockRows = (numberOfCells + blockHeight - 1U) / blockHeight;
+    m_blocks.resize(numberOfBlockRows * numberOfBlockColumns);
+
+    for (size_t blockRowIdx = 0U; blockRowIdx < numberOfBlockRows; ++blockRowIdx)
+    {
+        size_t const rowBegin = blockHeight * blockRowIdx;
+        size_t const rowEnd = std::min(rowBegin + blockHeight, numberOfCells) + 1U;
+
+        for (size_t blockColumnIdx = 0U; blockColumnIdx < numberOfBlockColumns; ++blockColumnIdx)
+        {
+            size_t const columnBegin = blockWidth * blockColumnIdx;
+            size_t const columnEnd = std::min(columnBegin + blockWidth, numberOfCells) + 1U;
+
+            Block block{values[DIM * rowBegin + columnBegin], values[DIM * rowBegin + columnBegin]};
+            for (size_t j = rowBegin; j < rowEnd; ++j)
+                extendRange(values.data() + DIM * j + columnBegin, columnEnd - columnBegin, block.min, block.max);
+
+            m_blocks[numberOfBlockColumns * blockRowIdx + blockColumnIdx] = block;
+        }
+    }
+}
+
+// Each row band of blocks is extracted into its own arena, isovalue by isovalue. Concatenating the arenas per isovalue
+// in band order then gives the isovalue-major, row-major block order of a single band, whatever the number of bands,
+// so the output does not depend on the number of threads.
+template <bool interpolate>
+void MarchingSquares::extractSegments(std::vector<float> const &values, size_t const DIM,
+                                      std::vector<float> const &isovalues, float const cellSideLength)
+{
+    buildBlockIndex(values, DIM);
+
+    size_t const numberOfIsovalues = isovalues.size();
+    size_t const numberOfBlockColumns = wordsPerRow(DIM - 1U);
+    size_t const numberOfBlockRows = m_blocks.size() / numberOfBlockColumns;
+    size_t const numberOfBands = parallel::numberOfRowBands(numberOfBlockRows, blockHeight * DIM * numberOfIsovalues);
+    m_bands.resize(numberOfBands);
+
+    parallel::forBands(numberOfBands, [&](size_t const bandIdx)
+    {
+        Band &band = m_bands[bandIdx];
+        band.vertices.clear();
+        band.isovalueOffsets.assign(numberOfIsovalues + 1U, 0U);
+
+        size_t const blockBegin = numberOfBlockColumns * parallel::bandBegin(numberOfBlockRows, numberOfBands, bandIdx);
+        size_t const blockEnd = numberOfBlockColumns * parallel::bandBegin(numberOfBlockRows, numberOfBands, bandIdx + 1U);
+        for (size_t isovalueIdx = 0U; isovalueIdx < numberOfIsovalues; ++isovalueIdx)
+        {
+            float const isovalue = isovalues[isovalueIdx];
+            for (size_t blockIdx = blockBegin; blockIdx < blockEnd; ++blockIdx)
+            {
+                // Only the isovalues in [min, max) cross a cell of the block.
+                if (m_blocks[blockIdx].min <= isovalue && isovalue < m_blocks[blockIdx].max)
+                    extractBlock<interpolate, false>(values, DIM, blockIdx, isovalue, cellSideLength, band);
+            }
+            band.isovalueOffsets[isovalueIdx + 1U] = band.vertices.size();
+        }
+    });
+
+    if (numberOfBands == 1U)
+    {
+        // Nothing to concatenate; the arena and the output trade buffers, so both keep their capacity.
+        m_vertices.swap(m_bands.front().vertices);
+        return;
+    }
+
+    // A prefix sum over the runs of vertices, in isovalue-major, band-minor order, gives where each run goes.
+    for (Band &band : m_bands)
+        band.destinations.resize(numberOfIsovalues);
+
+    size_t numberOfVertices = 0U;
+    for (size_t isovalueIdx = 0U; isovalueIdx < numberOfIsovalues; ++isovalueIdx)
+    {
+        for (Band &band : m_bands)
+        {
+            band.destinations[isovalueIdx] = numberOfVertices;
+            numberOfVertices += band.isovalueOffsets[isovalueIdx + 1U] - band.isovalueOffsets[isovalueIdx];
+        }
+    }
+
+    m_vertices.resize(numberOfVertices);
+    parallel::forBands(numberOfBands, [&](size_t const bandIdx)
+    {
+        Band const &band = m_bands[bandIdx];
+        for (size_t isovalueIdx = 0U; isovalueIdx < numberOfIsovalues; ++isovalueIdx)
+        {
+            std::copy(band.vertices.cbegin() + static_cast<std::ptrdiff_t>(band.isovalueOffsets[isovalueIdx]),
+                      band.vertices.cbegin() + static_cast<std::ptrdiff_t>(band.isovalueOffsets[isovalueIdx + 1U]),
+                      m_vertices.begin() + static_cast<std::ptrdiff_t>(band.destinations[isovalueIdx]));
+        }
+    });
+}
+
+// Like in extractSegments(), each row band of blocks is extracted into its own arena, isovalue by isovalue. Within a band
+// the blocks are visited in row-major order, so every crossing inside it is met again within the next block row, and
+// the band's edge table links the two. The crossings on the value rows where two bands meet are set aside instead and
+// linked once all bands are done. Concatenating the arenas per isovalue in band order then gives the segments and links
+// of a single band, so the polylines do not depend on the number of threads either.
+template <bool interpolate>
+void MarchingSquares::extractCells(std::vector<float> const &values, size_t const DIM,
+                                   std::vector<float> const &isovalues, float const cellSideLength)
+{
+    buildBlockIndex(values, DIM);
+
+    size_t const numberOfIsovalues = isovalues.size();
+    size_t const numberOfCells = DIM - 1U;
+    size_t const numberOfBlockColumns = wordsPerRow(numberOfCells);
+    size_t const numberOfBlockRows = m_blocks.size() / numberOfBlockColumns;
+    size_t const numberOfBands = parallel::numberOfRowBands(numberOfBlockRows, blockHeight * DIM * numberOfIsovalues);
+    m_bands.resize(numberOfBands);
+
+    // A power of two, so the slot of an edge is a mask of its ID. Edges that share a slot are at least
+    // edgeTableRows rows apart.
+    size_t edgeTableSize = 1U;
+    while (edgeTableSize < 2U * edgeTableRows * DIM)
+        edgeTableSize *= 2U;
+
+    parallel::forBands(numberOfBands, [&](size_t const bandIdx)
+    {
+        Band &band = m_bands[bandIdx];
+        band.vertices.clear();
+        band.endpointLinks.clear();
+        band.bottomSeam.clear();
+        band.topSeam.clear();
+        band.isovalueOffsets.assign(numberOfIsovalues + 1U, 0U);
+        band.bottomSeamOffsets.assign(numberOfIsovalues + 1U, 0U);
+        band.topSeamOffsets.assign(numberOfIsovalues + 1U, 0U);
+        band.edgeTable.resize(edgeTableSize, EdgeEntry{0U, 0U, 0U});
+
+        size_t const blockRowBegin = parallel::bandBegin(numberOfBlockRows, numberOfBands, bandIdx);
+        size_t const blockRowEnd = parallel::bandBegin(numberOfBlockRows, numberOfBands, bandIdx + 1U);
+        band.rowBegin = blockHeight * blockRowBegin;
+        band.rowEnd = std::min(blockHeight * blockRowEnd, numberOfCells);
+
+        for (size_t isovalueIdx = 0U; isovalueIdx < numberOfIsovalues; ++isovalueIdx)
+        {
+            float const isovalue = isovalues[isovalueIdx];
+
+            // A new stamp empties the edge table without clearing it; it is only cleared when the stamp wraps around.
+            if (++band.edgeTableStamp == 0U)
+            {
+                std::fill(band.edgeTable.begin(), band.edgeTable.end(), EdgeEntry{0U, 0U, 0U});
+                band.edgeTableStamp = 1U;
+            }
+
+            for (size_t blockIdx = numberOfBlockColumns * blockRowBegin; blockIdx < numberOfBlockColumns * blockRowEnd; ++blockIdx)
+            {
+                // Only the isovalues in [min, max) cross a cell of the block.
+                if (m_blocks[blockIdx].min <= isovalue && isovalue < m_blocks[blockIdx].max)
+                    extractBlock<interpolate, true>(values, DIM, blockIdx, isovalue, cellSideLength, band);
+            }
+
+            band.isovalueOffsets[isovalueIdx + 1U] = band.vertices.size();
+            band.bottomSeamOffsets[isovalueIdx + 1U] = band.bottomSeam.size();
+            band.topSeamOffsets[isovalueIdx + 1U] = band.topSeam.size();
+        }
+    });
+
+    if (numberOfBands == 1U)
+    {
+        // Nothing to concatenate or link; the arena and the segments trade buffers, so both keep their capacity.
+        Band &band = m_bands.front();
+        m_segmentVertices.swap(band.vertices);
+        m_endpointLinks.swap(band.endpointLinks);
+        for (size_t isovalueIdx = 0U; isovalueIdx <= numberOfIsovalues; ++isovalueIdx)
+            m_isovalueOffsets[isovalueIdx] = band.isovalueOffsets[isovalueIdx] / 2U;
+        return;
+    }
+
+    // A prefix sum over the runs of vertices, in isovalue-major, band-minor order, gives where each run goes.
+    for (Band &band : m_bands)
+        band.destinations.resize(numberOfIsovalues);
+
+    size_t numberOfVertices = 0U;
+    for (size_t isovalueIdx = 0U; isovalueIdx < numberOfIsovalues; ++isovalueIdx)
+    {
+        m_isovalueOffsets[isovalueIdx] = numberOfVertices / 2U;
+        for (Band &band : m_bands)
+        {
+            band.destinations[isovalueIdx] = numberOfVertices;
+            numberOfVertices += band.isovalueOffsets[isovalueIdx + 1U] - band.isovalueOffsets[isovalueIdx];
+        }
+    }
+    m_isovalueOffsets[numberOfIsovalues] = numberOfVertices / 2U;
+
+    // Links stay within the run of an isovalue, so they move by the same offset as the endpoints.
+    m_segmentVertices.resize(numberOfVertices);
+    m_endpointLinks.resize(numberOfVertices);
+    parallel::forBands(numberOfBands, [&](size_t const bandIdx)
+    {
+        Band const &band = m_bands[bandIdx];
+        for (size_t isovalueIdx = 0U; isovalueIdx < numberOfIsovalues; ++isovalueIdx)
+        {
+            size_t const begin = band.isovalueOffsets[isovalueIdx];
+            size_t const end = band.isovalueOffsets[isovalueIdx + 1U];
+            size_t const destination = band.destinations[isovalueIdx];
+            std::copy(band.vertices.cbegin() + static_cast<std::ptrdiff_t>(begin),
+                      band.vertices.cbegin() + static_cast<std::ptrdiff_t>(end),
+                      m_segmentVertices.begin() + static_cast<std::ptrdiff_t>(destination));
+
+            for (size_t endpoint = begin; endpoint < end; ++endpoint)
+            {
+                uint32_t const link = band.endpointLinks[endpoint];
+                m_endpointLinks[destination + endpoint - begin] = link == none ? none : static_cast<uint32_t>(destination + link - begin);
+            }
+        }
+    });
+
+    // Both bands at a seam meet its crossings, in increasing edge order and each once, so a merge pairs them up.
+    for (size_t bandIdx = 1U; bandIdx < numberOfBands; ++bandIdx)
+    {
+        Band const &below = m_bands[bandIdx - 1U];
+        Band const &above = m_bands[bandIdx];
+        for (size_t isovalueIdx = 0U; isovalueIdx < numberOfIsovalues; ++isovalueIdx)
+        {
+            auto const global = [&](Band const &band, uint32_t const endpoint)
+            {
+                return static_cast<uint32_t>(band.destinations[isovalueIdx] + endpoint - band.isovalueOffsets[isovalueIdx]);
+            };
+
+            size_t belowIdx = below.topSeamOffsets[isovalueIdx];
+            size_t aboveIdx = above.bottomSeamOffsets[isovalueIdx];
+            while (belowIdx < below.topSeamOffsets[isovalueIdx + 1U] && aboveIdx < above.bottomSeamOffsets[isovalueIdx + 1U])
+            {
+                SeamCrossing const &lower = below.topSeam[belowIdx];
+                SeamCrossing const &upper = above.bottomSeam[aboveIdx];
+                if (lower.edgeId < upper.edgeId)
+                    ++belowIdx;
+                else if (upper.edgeId < lower.edgeId)
+                    ++aboveIdx;
+                else
+                {
+                    m_endpointLinks[global(below, lower.endpoint)] = global(above, upper.endpoint);
+                    m_endpointLinks[global(above, upper.endpoint)] = global(below, lower.endpoint);
+                    ++belowIdx;
+                    ++aboveIdx;
+                }
+            }
+        }
+    }
+}
+
+template <bool interpolate, bool recordEdges>
+void MarchingSquares::extractBlock(std::vector<float> const &values, size_t const DIM, size_t const blockIdx,
+                                   float const isovalue, float const cellSideLength, Band &band)
+{
+    std::vector<IsolineVertex> &output = band.vertices;
+
+    size_t const numberOfBlockColumns = wordsPerRow(DIM - 1U);
+    size_t const blockRowIdx = blockIdx / numberOfBlockColumns;
+    size_t const blockColumnIdx = blockIdx % numberOfBlockColumns;
+
+    // Horizontal edge (i, j) -> (i + 1, j) has ID 2 * (i + DIM * j), vertical edge (i, j) -> (i, j + 1) the next one.
+    // These are the offsets of the edges of a cell relative to the ID of its bottom edge.
+    std::array<uint32_t, 4U> const edgeIdOffsets{0U, 3U, static_cast<uint32_t>(2U * DIM), 1U};
+
+    size_t const numberOfCells = DIM - 1U;
+    size_t const columnBegin = blockWidth * blockColumnIdx;
+    size_t const cellsInWord = std::min(blockWidth, numberOfCells - columnBegin);
+    uint64_t const cellMask = cellsInWord < 64U ? (uint64_t{1U} << cellsInWord) - 1U : ~uint64_t{0U};
+    size_t const valuesInWord = std::min(blockWidth, DIM - columnBegin);
+    bool const hasNextValue = columnBegin + blockWidth < DIM;
+
+    // Bit n of left is the left corner of cell columnBegin + n in the given row, bit n of right its right corner:
+    // the same bits shifted by one, plus the first value of the next word.
+    auto const classify = [&](size_t const rowIdx, uint64_t &left, uint64_t &right)
+    {
+        float const *row = values.data() + DIM * rowIdx + columnBegin;
+        left = classifyWord(row, valuesInWord, isovalue);
+        right = (left >> 1U) | (hasNextValue ? static_cast<uint64_t>(row[blockWidth] > isovalue) << 63U : 0U);
+    };
+
+    size_t const rowBegin = blockHeight * blockRowIdx;
+    size_t const rowEnd = std::min(rowBegin + blockHeight, numberOfCells);
+
+    uint64_t v0;
+    uint64_t v1;
+    classify(rowBegin, v0, v1);
+    for (size_t j = rowBegin; j < rowEnd; ++j)
+    {
+        // The top corners of this row are the bottom corners of the next one.
+        uint64_t v3;
+        uint64_t v2;
+        classify(j + 1U, v3, v2);
+
+        // A cell is crossed unless its corners are all above or all below the isovalue.
+        uint64_t crossed = (v0 | v1 | v2 | v3) & ~(v0 & v1 & v2 & v3) & cellMask;
+
+        float const *bottomRow = values.data() + DIM * j;
+        float const *topRow = bottomRow + DIM;
+        float const y = static_cast<float>(j + 1U) * cellSideLength;
+
+        while (crossed != 0U)
+        {
+            size_t const n = qCountTrailingZeroBits(crossed);
+            crossed &= crossed - 1U;
+
+            size_t const i = columnBegin + n;
+            std::array<float, 4U> const corners{bottomRow[i], bottomRow[i + 1U], topRow[i + 1U], topRow[i]};
+            bool const decider = (corners[0] - isovalue) * (corners[2] - isovalue)
+                               > (corners[1] - isovalue) * (corners[3] - isovalue);
+            size_t const caseIdx = bit(v0, n) | bit(v1, n) << 1U | bit(v2, n) << 2U | bit(v3, n) << 3U
+                                 | static_cast<size_t>(decider) << 4U;
+
+            // For drawing offset the cells a little to the right and up to make it match the scalar field.
+            QVector2D const bottomLeft{static_cast<float>(i + 1U) * cellSideLength, y};
+
+            CaseEdges const &crossedEdges = caseEdges[caseIdx];
+            for (size_t e = 0U; e < crossedEdges.numberOfEdges; ++e)
+            {
+                Edge const edge = crossedEdges.edges[e];
+                if constexpr (recordEdges)
+                {
+                    uint32_t const edgeId = static_cast<uint32_t>(2U * (i + DIM * j)) + edgeIdOffsets[edge];
+                    uint32_t const endpoint = static_cast<uint32_t>(output.size());
+                    band.endpointLinks.push_back(none);
+
+                    // The other cell on the bottom edges of the first row and the top edges of the last row lies in
+                    // the neighboring band; the seams are linked after extracting.
+                    if (edge == Bottom && j == band.rowBegin)
+                        band.bottomSeam.push_back({edgeId, endpoint});
+                    else if (edge == Top && j + 1U == band.rowEnd)
+                        band.topSeam.push_back({edgeId, endpoint});
+                    else
+                    {
+                        // Link this endpoint to the one on the same crossing, if that has been found already.
+                        EdgeEntry &entry = band.edgeTable[edgeId & (band.edgeTable.size() - 1U)];
+                        if (entry.stamp == band.edgeTableStamp && entry.edgeId == edgeId)
+                        {
+                            band.endpointLinks[endpoint] = entry.endpoint;
+                            band.endpointLinks[entry.endpoint] = endpoint;
+                        }
+                        else
+                            entry = {band.edgeTableStamp, edgeId, endpoint};
+                    }
+                }
+
+                float t = 0.5F;
+                if constexpr (interpolate)
+                {
+                    float const start = corners[edgeCorners[edge][0]];
+                    float const end = corners[edgeCorners[edge][1]];
+                    t = (isovalue - start) / (end - start);
+                }
+
+                output.push_back({bottomLeft + (edgeStart[edge] + t * edgeDirection[edge]) * cellSideLength, isovalue});
+            }
+        }
+
+        v0 = v3;
+        v1 = v2;
+    }
+}
+
+void MarchingSquares::stitchPolylines(size_t const numberOfIsovalues)
+{
+    size_t const numberOfSegments = m_segmentVertices.size() / 2U;
+
+    // Follows the chain of segments that starts by entering a segment at the given endpoint.
+    m_visited.assign(numberOfSegments, 0U);
+    auto const walk = [&](uint32_t endpoint)
+    {
+        m_vertices.push_back(m_segmentVertices[endpoint]);
+        while (endpoint != none && m_visited[endpoint / 2U] == 0U)
+        {
+            m_visited[endpoint / 2U] = 1U;
+            uint32_t const exit = endpoint ^ 1U;
+            m_vertices.push_back(m_segmentVertices[exit]);
+            endpoint = m_endpointLinks[exit];
+        }
+        m_polylineOffsets.push_back(m_vertices.size());
+    };
+
+    for (size_t k = 0U; k < numberOfIsovalues; ++k)
+    {
+        // Open polylines start at an endpoint without a neighbor, on the border of the field.
+        for (size_t segmentIdx = m_isovalueOffsets[k]; segmentIdx < m_isovalueOffsets[k + 1U]; ++segmentIdx)
+        {
+            if (m_visited[segmentIdx] != 0U)
+                continue;
+
+            if (m_endpointLinks[2U * segmentIdx] == none)
+                walk(2U * segmentIdx);
+            else if (m_endpointLinks[2U * segmentIdx + 1U] == none)
+                walk(2U * segmentIdx + 1U);
+        }
+
+        // The remaining segments form closed loops.
+        for (size_t segmentIdx = m_isovalueOffsets[k]; segmentIdx < m_isovalueOffsets[k + 1U]; ++segmentIdx)
+        {
+            if (m_visited[segmentIdx] == 0U)
+                walk(2U * segmentIdx);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#ifndef MARCHINGSQUARES_H
+#define MARCHINGSQUARES_H
+
+#include <QVector2D>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// An isoline vertex with the isovalue of its line, laid out as the isolines vertex buffer expects.
+struct IsolineVertex
+{
+    QVector2D position;
+    float isovalue;
+};
+
+/* Table-driven marching squares on a row-major DIM x DIM scalar field.
+ *
+ * As in Isoline, the case of a cell is a 4-bit index in which bit n is set when corner vn lies above the isovalue
+ * (value > isovalue), with v0 bottom left, v1 bottom right, v2 top right and v3 top left.
+ * A lookup table maps each case to the edges its segments cross and a second table maps each edge to its corners,
+ * so all cases share one code path. The saddle cases 5 and 10 are resolved with the asymptotic decider, which
+ * is part of the table index, so they take the same path too.
+ *
+ * Before extracting, extract() builds a span-space index: the minimum and maximum corner value of every block of
+ * 64 x 8 cells. A block can only be crossed by the isovalues in [minimum, maximum), so blocks of a constant
+ * region, like empty parts of the smoke, are skipped for all isovalues, and the others are visited only for the
+ * isovalues that cross them. This makes the cost follow the number of crossed blocks instead of the number of cells
+ * times the number of isovalues.
+ *
+ * Within a block, corners are classified a row at a time into one 64-bit bitmask word, one bit per value.
+ * Shifting and combining the words of two rows gives the crossed cells of the 64 cells at once, so only those are
+ * visited. The rows of blocks are divided over threads, each with its own vertex buffer that keeps its capacity
+ * across calls. These are concatenated per isovalue in row order, so the output is the same for any number of threads.
+ * Like Isoline, the cell with bottom left value (i, j) is drawn at ((i + 1), (j + 1)) * cellSideLength,
+ * which makes the lines match the scalar field.
+ *
+ * In OutputMode::Polylines the segments are stitched into connected polylines. Every crossing is identified by
+ * its grid edge, which the two cells sharing that edge compute bit-identically, so the endpoints of segments of
+ * the same isovalue are linked while extracting when their edge IDs match. Each thread links the crossings inside its
+ * rows; those on the rows where two threads meet are linked after extracting. Walking along the links then stores each
+ * crossing once, which halves the number of vertices and allows drawing with line strips.
+ */
+class MarchingSquares
+{
+    struct Block
+    {
+        float min;
+        float max;
+    };
+
+    struct EdgeEntry
+    {
+        uint32_t stamp;     // Entries with another stamp are empty.
+        uint32_t edgeId;
+        uint32_t endpoint;  // 2 * segment + end, which is also the index of its vertex.
+    };
+
+    // A crossing on the first or last value row of a band, which the neighboring band meets too.
+    struct SeamCrossing
+    {
+        uint32_t edgeId;
+        uint32_t endpoint;
+    };
+
+    // The vertices of a row band of blocks, the first vertex of every isovalue in them,
+    // and where the vertices of every isovalue go in the output.
+    struct Band
+    {
+        std::vector<IsolineVertex> vertices;
+        std::vector<size_t> isovalueOffsets;
+        std::vector<size_t> destinations;
+
+        // Polyline mode: the cell rows [rowBegin, rowEnd) of the band, the endpoint on the same crossing as each
+        // endpoint (if any) and the table that pairs them up, and per isovalue the crossings on the bottom edges of
+        // the first row and the top edges of the last row, which are linked to those of the neighboring bands.
+        size_t rowBegin = 0U;
+        size_t rowEnd = 0U;
+        std::vector<uint32_t> endpointLinks;
+        std::vector<EdgeEntry> edgeTable;
+        uint32_t edgeTableStamp = 0U;
+        std::vector<SeamCrossing> bottomSeam;
+        std::vector<SeamCrossing> topSeam;
+        std::vector<size_t> bottomSeamOffsets;
+        std::vector<size_t> topSeamOffsets;
+    };
+
+    std::vector<IsolineVertex> m_vertices;      // Output, reused between extractions.
+    std::vector<size_t> m_polylineOffsets;      // Polyline n spans [m_polylineOffsets[n], m_polylineOffsets[n + 1]).
+    std::vector<Block> m_blocks;                // Span-space index, row-major, wordsPerRow(DIM - 1) blocks per block row.
+    std::vector<Band> m_bands;                  // One arena per thread, reused between extractions.
+
+    // Polyline mode: the segments of all bands before stitching, the first segment of every isovalue,
+    // and the endpoint on the same crossing as each endpoint (if any).
+    std::vector<IsolineVertex> m_segmentVertices;
+    std::vector<size_t> m_isovalueOffsets;
+    std::vector<uint32_t> m_endpointLinks;
+    std::vector<unsigned char> m_visited;
+
+    void buildBlockIndex(std::vector<float> const &values, size_t const DIM);
+
+    template <bool interpolate>
+    void extractSegments(std::vector<float> const &values, size_t const DIM, std::vector<float> const &isovalues,
+                         float const cellSideLength);
+
+    template <bool interpolate>
+    void extractCells(std::vector<float> const &values, size_t const DIM, std::vector<float> const &isovalues,
+                      float const cellSideLength);
+
+    template <bool interpolate, bool recordEdges>
+    void extractBlock(std::vector<float> const &values, size_t const DIM, size_t const blockIdx, float const isovalue,
+                      float const cellSideLength, Band &band);
+
+    void stitchPolylines(size_t const numberOfIsovalues);
+
+public:
+    enum class InterpolationMethod
+    {
+        Linear, // Crossings are linearly interpolated along the cell edges.
+        None    // Crossings lie at the edge midpoints.
+    };
+
+    enum class OutputMode
+    {
+        Segments,   // Two vertices per segment, to be drawn as lines.
+        Polylines   // Connected polylines, to be drawn as line strips. Closed ones end with their first vertex.
+    };
+
+    // The isovalues must be sorted in increasing order.
+    void extract(std::vector<float> const &values, size_t const DIM, std::vector<float> const &isovalues,
+                 float const cellSideLength, InterpolationMethod const interpolationMethod,
+                 OutputMode const outputMode = OutputMode::Segments);
+
+    // The vertices of the last extraction. The buffer is reused, so the reference stays valid between extractions.
+    std::vector<IsolineVertex> const &vertices() const { return m_vertices; }
+
+    // Polyline mode: polyline n consists of the vertices [polylineOffsets()[n], polylineOffsets()[n + 1]).
+    // The polylines of one isovalue are consecutive, in increasing isovalue order.
+    std::vector<size_t> const &polylineOffsets() const { return m_polylineOffsets; }
+
+    // Number of 64-bit words in the bitmask of a row of the given length.
+    static size_t wordsPerRow(size_t const rowLength) { return (rowLength + 63U) / 64U; }
+
+    // Sets bit n % 64 of bits[n / 64] when row[n] > isovalue. Unused bits of the last word are cleared.
+    static void classifyRow(float const *row, size_t const rowLength, float const isovalue, uint64_t *bits);
+};
+
+#endif // MARCHINGSQUARES_H
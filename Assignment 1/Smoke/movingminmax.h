@@ -0,0 +1,140 @@
+#ifndef MOVINGMINMAX_H
+#define MOVINGMINMAX_H
+
+#include <QDebug>
+
+#include <cstddef>
+#include <vector>
+
+// Sliding window extrema of a stream of [min, max] ranges.
+// min() is the smallest minimum and max() the largest maximum of the last m_windowSize updates.
+// Both are tracked with a monotonic deque, so an update is amortized O(1).
+// The deques live in fixed-capacity ring buffers, so updates never allocate.
+template <typename T>
+class MovingMinMax
+{
+    struct Entry
+    {
+        size_t time;
+        T value;
+    };
+
+    // Double-ended queue on top of a contiguous ring buffer with a fixed capacity.
+    class RingDeque
+    {
+        std::vector<Entry> m_ring;
+        size_t m_head = 0U;
+        size_t m_size = 0U;
+
+    public:
+        void reset(size_t const capacity)
+        {
+            m_ring.resize(capacity);
+            m_head = 0U;
+            m_size = 0U;
+        }
+
+        bool empty() const { return m_size == 0U; }
+        Entry const &front() const { return m_ring[m_head]; }
+        Entry const &back() const { return m_ring[(m_head + m_size - 1U) % m_ring.size()]; }
+
+        void pushBack(Entry const &entry)
+        {
+            Q_ASSERT(m_size < m_ring.size());
+            m_ring[(m_head + m_size) % m_ring.size()] = entry;
+            ++m_size;
+        }
+
+        void popBack() { --m_size; }
+
+        void popFront()
+        {
+            m_head = (m_head + 1U == m_ring.size()) ? 0U : m_head + 1U;
+            --m_size;
+        }
+    };
+
+    size_t m_windowSize;
+    T const m_initialValue;
+
+    size_t m_time = 0U;
+    RingDeque m_minima; // Increasing values, the front is the window minimum.
+    RingDeque m_maxima; // Decreasing values, the front is the window maximum.
+
+    void fillWindow();
+
+public:
+    MovingMinMax(size_t const windowSize, T const &initialValue);
+
+    void update(T const &newMin, T const &newMax);
+    T min() const;
+    T max() const;
+
+    void setWindowSize(size_t const windowSize);
+};
+
+template <typename T>
+MovingMinMax<T>::MovingMinMax(size_t const windowSize, T const &initialValue)
+:
+    m_windowSize(windowSize),
+    m_initialValue(initialValue)
+{
+    Q_ASSERT(m_windowSize > 0);
+    fillWindow();
+}
+
+template <typename T>
+void MovingMinMax<T>::setWindowSize(size_t const windowSize)
+{
+    Q_ASSERT(windowSize > 0);
+    m_windowSize = windowSize;
+
+    fillWindow();
+}
+
+// Equivalent to a window filled with initial values: the monotonic deques collapse equal values
+// into the most recent one, so a single entry that expires after m_windowSize updates suffices.
+template <typename T>
+void MovingMinMax<T>::fillWindow()
+{
+    m_minima.reset(m_windowSize);
+    m_maxima.reset(m_windowSize);
+
+    m_time = m_windowSize;
+    m_minima.pushBack({m_time - 1U, m_initialValue});
+    m_maxima.pushBack({m_time - 1U, m_initialValue});
+}
+
+template <typename T>
+void MovingMinMax<T>::update(T const &newMin, T const &newMax)
+{
+    // Drop values that slide out of the window.
+    if (m_minima.front().time + m_windowSize <= m_time)
+        m_minima.popFront();
+    if (m_maxima.front().time + m_windowSize <= m_time)
+        m_maxima.popFront();
+
+    // Drop values that can never become the extremum again.
+    while (!m_minima.empty() && !(m_minima.back().value < newMin))
+        m_minima.popBack();
+    while (!m_maxima.empty() && !(newMax < m_maxima.back().value))
+        m_maxima.popBack();
+
+    m_minima.pushBack({m_time, newMin});
+    m_maxima.pushBack({m_time, newMax});
+    ++m_time;
+}
+
+template <typename T>
+T MovingMinMax<T>::min() const
+{
+    return m_minima.front().value;
+}
+
+template <typename T>
+T MovingMinMax<T>::max() const
+{
+    return m_maxima.front().value;
+}
+
+#endif // MOVINGMINMAX_H
@@ -0,0 +1,173 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+    // Below this amount of work (roughly the number of visited values) handing out bands costs more than it saves.
+    size_t const minimumWorkPerThread = 1U << 16U;
+
+    // The number of row bands forRowBands() splits numberOfRows rows into.
+    inline size_t numberOfRowBands(size_t const numberOfRows, size_t const workPerRow)
+    {
+        size_t const hardwareThreads = std::max(1U, std::thread::hardware_concurrency());
+        size_t const usefulThreads = std::max<size_t>(1U, numberOfRows * workPerRow / minimumWorkPerThread);
+
+        return std::max<size_t>(1U, std::min({hardwareThreads, usefulThreads, numberOfRows}));
+    }
+
+    // The first row of band bandIdx when numberOfRows rows are split into numberOfBands contiguous bands.
+    inline size_t bandBegin(size_t const numberOfRows, size_t const numberOfBands, size_t const bandIdx)
+    {
+        return numberOfRows * bandIdx / numberOfBands;
+    }
+
+    /* One worker per hardware thread but the first, started on first use and kept until the program ends.
+     * run() hands the bands of a call to the workers and the calling thread, which all take the next band that is
+     * left until none are, so any number of bands is spread over the threads there are.
+     */
+    class ThreadPool
+    {
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_workDone;
+        std::vector<std::thread> m_workers;
+
+        std::function<void(size_t)> const *m_function = nullptr;
+        size_t m_numberOfBands = 0U;
+        size_t m_nextBand = 0U;
+        size_t m_bandsDone = 0U;
+        uint64_t m_generation = 0U;    // Counts the calls of run(), so the workers notice a new one.
+        bool m_stopping = false;
+
+        // Set on the threads while they run a band, so a nested call runs on its own thread instead of waiting
+        // for itself.
+        static bool &insideBand()
+        {
+            thread_local bool inside = false;
+            return inside;
+        }
+
+        // Runs bands until none are left. Called with m_mutex locked, which is released while a band runs.
+        void runBands(std::unique_lock<std::mutex> &lock)
+        {
+            while (m_nextBand < m_numberOfBands)
+            {
+                size_t const bandIdx = m_nextBand++;
+                lock.unlock();
+                insideBand() = true;
+                (*m_function)(bandIdx);
+                insideBand() = false;
+                lock.lock();
+
+                if (++m_bandsDone == m_numberOfBands)
+                    m_workDone.notify_all();
+            }
+        }
+
+        void work()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            uint64_t generation = m_generation;
+            while (true)
+            {
+                m_workAvailable.wait(lock, [&] { return m_stopping || m_generation != generation; });
+                if (m_stopping)
+                    return;
+
+                generation = m_generation;
+                runBands(lock);
+            }
+        }
+
+        ThreadPool()
+        {
+            size_t const numberOfWorkers = std::max(1U, std::thread::hardware_concurrency()) - 1U;
+            m_workers.reserve(numberOfWorkers);
+            for (size_t workerIdx = 0U; workerIdx < numberOfWorkers; ++workerIdx)
+                m_workers.emplace_back(&ThreadPool::work, this);
+        }
+
+    public:
+        ThreadPool(ThreadPool const &) = delete;
+        ThreadPool &operator=(ThreadPool const &) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> const lock(m_mutex);
+                m_stopping = true;
+            }
+            m_workAvailable.notify_all();
+            for (auto &worker : m_workers)
+                worker.join();
+        }
+
+        static ThreadPool &instance()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        // Calls function(bandIdx) once for every bandIdx in [0, numberOfBands) and returns once all bands are done.
+        void run(size_t const numberOfBands, std::function<void(size_t)> const &function)
+        {
+            if (numberOfBands <= 1U || m_workers.empty() || insideBand())
+            {
+                for (size_t bandIdx = 0U; bandIdx < numberOfBands; ++bandIdx)
+                    function(bandIdx);
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Another thread's call has to finish first; the workers serve one call at a time.
+            m_workDone.wait(lock, [&] { return m_function == nullptr; });
+
+            m_function = &function;
+            m_numberOfBands = numberOfBands;
+            m_nextBand = 0U;
+            m_bandsDone = 0U;
+            ++m_generation;
+            m_workAvailable.notify_all();
+
+            runBands(lock);
+            m_workDone.wait(lock, [&] { return m_bandsDone == m_numberOfBands; });
+
+            m_function = nullptr;
+            m_workDone.notify_all();
+        }
+    };
+
+    /* Calls function(bandIdx) once for every bandIdx in [0, numberOfBands) on the threads of the ThreadPool,
+     * the calling thread included. Returns once all bands are done.
+     */
+    template <typename Function>
+    void forBands(size_t const numberOfBands, Function const &function)
+    {
+        ThreadPool::instance().run(numberOfBands, std::cref(function));
+    }
+
+    /* Splits the rows [0, numberOfRows) into contiguous bands and calls function(rowBegin, rowEnd) once per band,
+     * on the threads of the ThreadPool. Returns once all bands are done. Bands never overlap, so each call may write
+     * its own rows without locking.
+     */
+    template <typename Function>
+    void forRowBands(size_t const numberOfRows, size_t const workPerRow, Function const &function)
+    {
+        size_t const numberOfBands = numberOfRowBands(numberOfRows, workPerRow);
+        forBands(numberOfBands, [&](size_t const bandIdx)
+        {
+            function(bandBegin(numberOfRows, numberOfBands, bandIdx), bandBegin(numberOfRows, numberOfBands, bandIdx + 1U));
+        });
+    }
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,140 @@
+#include "quantization.h"
+
+#include "simd.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Precomputed factors of the two quantization steps.
+    struct Factors
+    {
+        float toPixel;  // 255 / maxValue
+        float toLevel;  // (L + 1) / 255
+        float maxLevel; // L
+    };
+
+    // Half a bin of the level step. The products p * (L + 1) / 255 are multiples of 1 / 255, so adding less than that
+    // to them can not change the outcome of the floor, but it does absorb the rounding error of the multiplication
+    // when a product should be exactly integral.
+    float const levelBias = 0.5F / 255.0F;
+
+    Factors factors(float const maxValue, unsigned int const bits)
+    {
+        float const maxLevel = static_cast<float>(quantization::maxLevel(bits));
+
+        // An all-zero (or negative) field maps to level 0 instead of dividing by zero.
+        float const toPixel = maxValue > 0.0F ? 255.0F / maxValue : 0.0F;
+        return {toPixel, (maxLevel + 1.0F) / 255.0F, maxLevel};
+    }
+
+    float levelOf(float const x, Factors const &f)
+    {
+        float const pixel = std::min(std::floor(std::max(x * f.toPixel, 0.0F) + 0.5F), 255.0F);
+        return std::min(std::floor(pixel * f.toLevel + levelBias), f.maxLevel);
+    }
+
+#ifdef SIMD_AVX2
+    SIMD_AVX2_TARGET __m256 levelOf(__m256 const x, Factors const &f)
+    {
+        __m256 const scaled = _mm256_max_ps(_mm256_mul_ps(x, _mm256_set1_ps(f.toPixel)), _mm256_setzero_ps());
+        __m256 const pixel = _mm256_min_ps(_mm256_floor_ps(_mm256_add_ps(scaled, _mm256_set1_ps(0.5F))),
+                                           _mm256_set1_ps(255.0F));
+        __m256 const level = _mm256_floor_ps(_mm256_fmadd_ps(pixel, _mm256_set1_ps(f.toLevel), _mm256_set1_ps(levelBias)));
+        return _mm256_min_ps(level, _mm256_set1_ps(f.maxLevel));
+    }
+
+    // The maximum of the first size / 8 * 8 values (size >= 8). Returns the number of values it covered.
+    SIMD_AVX2_TARGET size_t maximumAvx2(float const *values, size_t const size, float &result)
+    {
+        __m256 maxima = _mm256_loadu_ps(values);
+        size_t idx = 8U;
+        for (; idx + 8U <= size; idx += 8U)
+            maxima = _mm256_max_ps(maxima, _mm256_loadu_ps(values + idx));
+
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, maxima);
+        result = *std::max_element(lanes, lanes + 8);
+        return idx;
+    }
+
+    // Quantizes the first size / 8 * 8 values. Returns the number of values it covered.
+    SIMD_AVX2_TARGET size_t quantizeAvx2(float const *input, float *output, size_t const size, Factors const &f)
+    {
+        size_t idx = 0U;
+        for (; idx + 8U <= size; idx += 8U)
+            _mm256_storeu_ps(output + idx, levelOf(_mm256_loadu_ps(input + idx), f));
+        return idx;
+    }
+
+    // Same, with 8 bit output. Returns the number of values it covered.
+    SIMD_AVX2_TARGET size_t quantizeAvx2(float const *input, uint8_t *output, size_t const size, Factors const &f)
+    {
+        size_t idx = 0U;
+        for (; idx + 8U <= size; idx += 8U)
+        {
+            // Levels are exact integers in [0, 255]: narrow 32 -> 16 -> 8 bit and store the low 8 bytes.
+            __m256i const levels = _mm256_cvtps_epi32(levelOf(_mm256_loadu_ps(input + idx), f));
+            __m128i const words = _mm_packus_epi32(_mm256_castsi256_si128(levels), _mm256_extracti128_si256(levels, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(output + idx), _mm_packus_epi16(words, words));
+        }
+        return idx;
+    }
+#endif
+}
+
+namespace quantization
+{
+    unsigned int maxLevel(unsigned int const bits)
+    {
+        Q_ASSERT(bits >= 1U && bits <= 16U);
+        return (1U << bits) - 1U;
+    }
+
+    float maximum(float const *values, size_t const size)
+    {
+        if (size == 0U)
+            return 0.0F;
+
+        size_t idx = 0U;
+        float result = values[0];
+#ifdef SIMD_AVX2
+        if (size >= 8U && simd::hasAvx2())
+            idx = maximumAvx2(values, size, result);
+#endif
+        for (; idx < size; ++idx)
+            result = std::max(result, values[idx]);
+
+        return result;
+    }
+
+    void quantize(float const *input, float *output, size_t const size, float const maxValue, unsigned int const bits)
+    {
+        Factors const f = factors(maxValue, bits);
+
+        size_t idx = 0U;
+#ifdef SIMD_AVX2
+        if (simd::hasAvx2())
+            idx = quantizeAvx2(input, output, size, f);
+#endif
+        for (; idx < size; ++idx)
+            output[idx] = levelOf(input[idx], f);
+    }
+
+    void quantize(float const *input, uint8_t *output, size_t const size, float const maxValue, unsigned int const bits)
+    {
+        Q_ASSERT(bits <= 8U);
+        Factors const f = factors(maxValue, bits);
+
+        size_t idx = 0U;
+#ifdef SIMD_AVX2
+        if (simd::hasAvx2())
+            idx = quantizeAvx2(input, output, size, f);
+#endif
+        for (; idx < size; ++idx)
+            output[idx] = static_cast<uint8_t>(levelOf(input[idx], f));
+    }
+}
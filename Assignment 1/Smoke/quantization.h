@@ -0,0 +1,30 @@
+#ifndef QUANTIZATION_H
+#define QUANTIZATION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Quantization of scalar fields into 2^bits levels.
+ *
+ * A value x is first mapped to an 8 bit pixel p = round(x / maxValue * 255), clamped to [0, 255],
+ * and then to the level min(floor(p / (255 / 2^bits)), L), i.e. the range [0, 255] is split into 2^bits bins of
+ * width 255 / 2^bits, with p = 255 in the top bin.
+ * The divisions are replaced by multiplications with precomputed reciprocals and 8 values are processed at once
+ * when AVX2 is available.
+ */
+namespace quantization
+{
+    // The highest level L = 2^bits - 1. Values are quantized to {0, 1, .., L}.
+    unsigned int maxLevel(unsigned int const bits);
+
+    // The largest of the size values, or 0 when size == 0.
+    float maximum(float const *values, size_t const size);
+
+    // Quantizes size values. Input and output may be the same buffer.
+    void quantize(float const *input, float *output, size_t const size, float const maxValue, unsigned int const bits);
+
+    // Same, but with 8 bit output (bits <= 8), e.g. to upload the levels as GL_R8 / GL_UNSIGNED_BYTE data.
+    void quantize(float const *input, uint8_t *output, size_t const size, float const maxValue, unsigned int const bits);
+}
+
+#endif // QUANTIZATION_H
@@ -1,11 +1,18 @@
 #version 330 core
 // isolines fragment shader
 
+in float value;
+
 uniform vec3 isolineColor;
+uniform bool useColorMap;
+uniform sampler1D textureSampler;
 
 out vec4 color;
 
 void main()
 {
-    color = vec4(isolineColor, 1.0F);
+    if (useColorMap)
+        color = vec4(texture(textureSampler, value).rgb, 1.0F);
+    else
+        color = vec4(isolineColor, 1.0F);
 }
@@ -2,11 +2,18 @@
 // isolines vertex shader
 
 layout (location = 0) in vec2 vertCoordinates_in;
-layout (location = 1) in float height;
+layout (location = 1) in float isovalue_in;
 
 uniform mat4 projectionTransform;
+uniform float isovalueMin;
+uniform float isovalueMax;
+
+out float value;
 
 void main()
 {
-    gl_Position = projectionTransform * vec4(vertCoordinates_in, height, 1.0F);
+    gl_Position = projectionTransform * vec4(vertCoordinates_in, 0.0F, 1.0F);
+
+    // Position of the isovalue in the range of isovalues, which selects the color map entry.
+    value = isovalueMax > isovalueMin ? (isovalue_in - isovalueMin) / (isovalueMax - isovalueMin) : 0.5F;
 }
@@ -12,12 +12,42 @@ uniform float transferK;
 
 uniform mat4 projectionTransform;
 
+// Space-time slicing: when sliceVolume is set, the value is taken from the slicing window (a 3D texture)
+// instead of value_in. Grid vertex (column, row) samples the volume at
+// sliceOrigin + column * sliceColumnStep + row * sliceRowStep (texture coordinates).
+uniform bool sliceVolume;
+uniform sampler3D volumeSampler;
+uniform int DIM;
+uniform vec3 sliceOrigin;
+uniform vec3 sliceColumnStep;
+uniform vec3 sliceRowStep;
+
+// 8 bit levels: when levelsTexture is set, the value is the quantization level of grid vertex (column, row),
+// stored as level / 255 in a GL_R8 texture, instead of value_in.
+uniform bool levelsTexture;
+uniform sampler2D levelsSampler;
+
+float scalarValue()
+{
+    if (!sliceVolume && !levelsTexture)
+        return value_in;
+
+    // The vertices are numbered column + DIM * row.
+    int column = gl_VertexID % DIM;
+    int row = gl_VertexID / DIM;
+    if (levelsTexture)
+        return round(texelFetch(levelsSampler, ivec2(column, row), 0).r * 255.0F);
+
+    vec3 coordinates = sliceOrigin + float(column) * sliceColumnStep + float(row) * sliceRowStep;
+    return texture(volumeSampler, coordinates).r;
+}
+
 void main()
 {
     gl_Position = projectionTransform * vec4(vertCoordinates_in, 0.0F, 1.0F);
 
     // Clamp values.
-    value = clamp(value_in, clampMin, clampMax);
+    value = clamp(scalarValue(), clampMin, clampMax);
 
     // Map the range [clampMin, clampMax] to [0, 1].
     value = (value - clampMin) / (clampMax - clampMin);
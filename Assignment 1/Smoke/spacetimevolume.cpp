@@ -0,0 +1,110 @@
+#include "spacetimevolume.h"
+
+#include <QtGlobal>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+SpaceTimeVolume::SpaceTimeVolume(size_t const DIM, size_t const length)
+{
+    resize(DIM, length);
+}
+
+void SpaceTimeVolume::resize(size_t const DIM, size_t const length)
+{
+    Q_ASSERT(DIM > 0U && length > 0U);
+
+    m_DIM = DIM;
+    m_length = length;
+    m_volume.assign(layerSize() * m_length, 0.0F);
+    m_head = 0U;
+}
+
+void SpaceTimeVolume::push(float const *layer)
+{
+    // The oldest layer is the one just after the head.
+    m_head = (m_head + 1U == m_length) ? 0U : m_head + 1U;
+    std::copy(layer, layer + layerSize(), m_volume.begin() + static_cast<std::ptrdiff_t>(layerSize() * m_head));
+}
+
+size_t SpaceTimeVolume::storageIdx(size_t const age) const
+{
+    Q_ASSERT(age < m_length);
+    return (m_head + m_length - age) % m_length;
+}
+
+float const *SpaceTimeVolume::layer(size_t const age) const
+{
+    return m_volume.data() + layerSize() * storageIdx(age);
+}
+
+float SpaceTimeVolume::ageStep() const
+{
+    // Column 0 shows the most recent layer and column DIM - 1 the oldest.
+    return m_DIM > 1U ? static_cast<float>(m_length - 1U) / static_cast<float>(m_DIM - 1U) : 0.0F;
+}
+
+size_t SpaceTimeVolume::ageOfColumn(size_t const columnIdx) const
+{
+    return m_DIM > 1U ? (columnIdx * (m_length - 1U) + (m_DIM - 1U) / 2U) / (m_DIM - 1U) : 0U;
+}
+
+void SpaceTimeVolume::sliceX(size_t const xIdx, float *output) const
+{
+    Q_ASSERT(xIdx < m_DIM);
+
+    // Column tIdx of the slice is column xIdx of one layer: a copy with stride DIM.
+    for (size_t tIdx = 0U; tIdx < m_DIM; ++tIdx)
+    {
+        float const *source = layer(ageOfColumn(tIdx)) + xIdx;
+        for (size_t yIdx = 0U; yIdx < m_DIM; ++yIdx)
+            output[m_DIM * yIdx + tIdx] = source[m_DIM * yIdx];
+    }
+}
+
+void SpaceTimeVolume::sliceY(size_t const yIdx, float *output) const
+{
+    Q_ASSERT(yIdx < m_DIM);
+
+    // Column tIdx of the slice is row yIdx of one layer, transposed.
+    for (size_t tIdx = 0U; tIdx < m_DIM; ++tIdx)
+    {
+        float const *source = layer(ageOfColumn(tIdx)) + m_DIM * yIdx;
+        for (size_t xIdx = 0U; xIdx < m_DIM; ++xIdx)
+            output[m_DIM * xIdx + tIdx] = source[xIdx];
+    }
+}
+
+void SpaceTimeVolume::sliceT(size_t const age, float *output) const
+{
+    float const *source = layer(std::min(age, m_length - 1U));
+    std::copy(source, source + layerSize(), output);
+}
+
+void SpaceTimeVolume::sliceOblique(float const angleDegrees, size_t const offsetIdx, float *output) const
+{
+    float const angle = qDegreesToRadians(angleDegrees);
+    float const directionX = std::sin(angle);   // Direction of the rows in the xy-plane.
+    float const directionY = std::cos(angle);
+    float const normalX = directionY;           // Direction of the offset.
+    float const normalY = -directionX;
+
+    float const center = 0.5F * static_cast<float>(m_DIM);
+    float const offset = static_cast<float>(offsetIdx) + 0.5F - center;
+
+    for (size_t tIdx = 0U; tIdx < m_DIM; ++tIdx)
+    {
+        float const *source = layer(ageOfColumn(tIdx));
+        for (size_t rowIdx = 0U; rowIdx < m_DIM; ++rowIdx)
+        {
+            // Nearest grid point of the position along the row.
+            float const along = static_cast<float>(rowIdx) + 0.5F - center;
+            float const x = std::floor(center + offset * normalX + along * directionX);
+            float const y = std::floor(center + offset * normalY + along * directionY);
+
+            bool const inside = x >= 0.0F && y >= 0.0F && x < static_cast<float>(m_DIM) && y < static_cast<float>(m_DIM);
+            output[m_DIM * rowIdx + tIdx] = inside ? source[static_cast<size_t>(x) + m_DIM * static_cast<size_t>(y)] : 0.0F;
+        }
+    }
+}
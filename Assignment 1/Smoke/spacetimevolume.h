@@ -0,0 +1,57 @@
+#ifndef SPACETIMEVOLUME_H
+#define SPACETIMEVOLUME_H
+
+#include <cstddef>
+#include <vector>
+
+/* The last m_length DIM x DIM scalar fields, stored as one contiguous DIM x DIM x m_length volume.
+ *
+ * The volume is a ring buffer of layers: push() overwrites the oldest layer in place and advances m_head,
+ * so adding a time step copies one layer and never allocates. A layer's age is the number of time steps
+ * since it was pushed: age 0 is the most recent layer, age m_length - 1 the oldest.
+ *
+ * The slices are DIM x DIM fields like the scalar data itself. In the x, y and oblique slices, the columns run
+ * over time (column 0 is the most recent layer); when m_length != DIM the columns are spread evenly over the window.
+ *
+ * An oblique slice contains the time axis and cuts the xy-plane along the direction (sin(angle), cos(angle))
+ * at distance offsetIdx + 0.5 - DIM / 2 (in cells) from the center, measured along (cos(angle), -sin(angle)).
+ * Angle 0 gives the x slice at xIdx = offsetIdx; positions outside the grid are 0.
+ */
+class SpaceTimeVolume
+{
+    size_t m_DIM;
+    size_t m_length;
+    std::vector<float> m_volume;    // Layer after layer, each layer is a row-major DIM x DIM field.
+    size_t m_head = 0U;             // Storage index of the most recent layer.
+
+    size_t layerSize() const { return m_DIM * m_DIM; }
+
+public:
+    SpaceTimeVolume(size_t const DIM, size_t const length);
+
+    // Changes the dimensions. The contents are reset to zero.
+    void resize(size_t const DIM, size_t const length);
+
+    // Adds a DIM x DIM field as the most recent layer, replacing the oldest one.
+    void push(float const *layer);
+
+    size_t DIM() const { return m_DIM; }
+    size_t length() const { return m_length; }
+
+    // Storage index of the layer with the given age, i.e. its z coordinate in the volume.
+    size_t storageIdx(size_t const age) const;
+    float const *layer(size_t const age) const;
+    float const *data() const { return m_volume.data(); }
+
+    // Extract a DIM x DIM slice into output. For sliceT, ages beyond the window are clamped to the oldest layer.
+    void sliceX(size_t const xIdx, float *output) const;
+    void sliceY(size_t const yIdx, float *output) const;
+    void sliceT(size_t const age, float *output) const;
+    void sliceOblique(float const angleDegrees, size_t const offsetIdx, float *output) const;
+
+    // The age of the layer shown in column columnIdx of an x, y or oblique slice: round(columnIdx * ageStep()).
+    size_t ageOfColumn(size_t const columnIdx) const;
+    float ageStep() const;
+};
+
+#endif // SPACETIMEVOLUME_H
@@ -1,17 +1,21 @@
 #include "visualization.h"
 
 #include "constants.h"
-#include "isoline.h"
+#include "convolution.h"
 #include "mainwindow.h"
+#include "quantization.h"
 #include "texture.h"
 
 #include <fftw3.h>
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QtMath>
 
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <vector>
 
 Visualization::Visualization(QWidget *parent) : QOpenGLWidget(parent)
@@ -21,6 +25,10 @@ Visualization::Visualization(QWidget *parent) : QOpenGLWidget(parent)
     // Start the simulation loop.
     m_timer.start(17); // Each frame takes 17ms, making the simulation run at approximately 60 FPS
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(do_one_simulation_step()));
+
+    // The preprocessing stage timings are shown twice a second instead of every frame.
+    m_preprocessingTimingsTimer.start(500);
+    connect(&m_preprocessingTimingsTimer, SIGNAL(timeout()), this, SLOT(sendPreprocessingStageTimingsToUI()));
 }
 
 Visualization::~Visualization()
@@ -46,6 +54,8 @@ Visualization::~Visualization()
 
     glDeleteTextures(1, &m_scalarDataTextureLocation);
     glDeleteTextures(1, &m_vectorDataTextureLocation);
+    glDeleteTextures(1, &m_spaceTimeVolumeTextureLocation);
+    glDeleteTextures(1, &m_quantizedLevelsTextureLocation);
 }
 
 void Visualization::do_one_simulation_step()
@@ -96,6 +106,8 @@ void Visualization::initializeGL() {
     glGenBuffers(1, &m_vboScalarData);
     glGenBuffers(1, &m_eboScalarData);
     glGenTextures(1, &m_scalarDataTextureLocation);
+    glGenTextures(1, &m_spaceTimeVolumeTextureLocation);
+    glGenTextures(1, &m_quantizedLevelsTextureLocation);
 
     glGenVertexArrays(1, &m_vaoIsolines);
     glGenBuffers(1, &m_vboIsolines);
@@ -111,6 +123,7 @@ void Visualization::initializeGL() {
     setupAllBuffers();
 
     loadScalarDataTexture(defaultScalarDataColorMap);
+    loadIsolinesTexture(Texture::createRainbowTexture(256U));
 
     rotateView();
     m_normalTransformationMatrix.setToIdentity();
@@ -180,11 +193,13 @@ void Visualization::setupIsolines()
 
     // Set vertex coordinates to location 0
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), reinterpret_cast<GLvoid*>(0));
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(IsolineVertex),
+                          reinterpret_cast<GLvoid*>(offsetof(IsolineVertex, position)));
 
-    // Set height to location 1
+    // Set isovalue to location 1
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(QVector3D), reinterpret_cast<GLvoid*>(2 * sizeof(float)));
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(IsolineVertex),
+                          reinterpret_cast<GLvoid*>(offsetof(IsolineVertex, isovalue)));
 }
 
 void Visualization::setupHeightplot()
@@ -326,6 +341,14 @@ void Visualization::createShaderProgramIsolines()
     Q_ASSERT(m_uniformLocationIsolines_projection != -1);
     m_uniformLocationIsolines_color = m_shaderProgramIsolines.uniformLocation("isolineColor");
     Q_ASSERT(m_uniformLocationIsolines_color != -1);
+    m_uniformLocationIsolines_isovalueMin = m_shaderProgramIsolines.uniformLocation("isovalueMin");
+    Q_ASSERT(m_uniformLocationIsolines_isovalueMin != -1);
+    m_uniformLocationIsolines_isovalueMax = m_shaderProgramIsolines.uniformLocation("isovalueMax");
+    Q_ASSERT(m_uniformLocationIsolines_isovalueMax != -1);
+    m_uniformLocationIsolines_useColorMap = m_shaderProgramIsolines.uniformLocation("useColorMap");
+    Q_ASSERT(m_uniformLocationIsolines_useColorMap != -1);
+    m_uniformLocationIsolines_texture = m_shaderProgramIsolines.uniformLocation("textureSampler");
+    Q_ASSERT(m_uniformLocationIsolines_texture != -1);
 
     qDebug() << "m_shaderProgramIsolines initialized.";
 }
@@ -410,6 +433,23 @@ void Visualization::loadScalarDataTexture(std::vector<Color> const &colorMap)
                  colorMap.data());
 }
 
+void Visualization::loadIsolinesTexture(std::vector<Color> const &colorMap)
+{
+    glBindTexture(GL_TEXTURE_1D, m_isolinesTextureLocation);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glTexImage1D(GL_TEXTURE_1D,
+                 0,
+                 GL_RGB32F,
+                 static_cast<GLint>(colorMap.size()),
+                 0,
+                 GL_RGB,
+                 GL_FLOAT,
+                 colorMap.data());
+}
+
 void Visualization::paintGL()
 {
     glBindVertexArray(0);
@@ -431,6 +471,12 @@ void Visualization::paintGL()
         m_shaderProgramIsolines.bind();
         glUniformMatrix4fv(m_uniformLocationIsolines_projection, 1, GL_FALSE, m_projectionTransformationMatrix.data());
         glUniform3fv(m_uniformLocationIsolines_color, 1, &m_isolineColor[0]);
+        glUniform1f(m_uniformLocationIsolines_isovalueMin, std::min(m_isolineMinValue, m_isolineMaxValue));
+        glUniform1f(m_uniformLocationIsolines_isovalueMax, std::max(m_isolineMinValue, m_isolineMaxValue));
+        glUniform1i(m_uniformLocationIsolines_useColorMap, m_colorIsolinesByValue);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_1D, m_isolinesTextureLocation);
+        glUniform1i(m_uniformLocationIsolines_texture, 0);
         drawIsolines();
     }
 }
@@ -488,171 +534,319 @@ void Visualization::updateScalarPoints()
                     scalarPoints.data());
 }
 
-void Visualization::applyQuantization(std::vector<float> &scalarValues)
+void Visualization::applyQuantization(std::vector<float> const &input, std::vector<float> &output)
 {
-    // Convert the floating point values to (8 bit) unsigned integers,
-    // so that the data can be treated as an image.
-    // The image's pixel values are in the range [0, 255].
-    float const maxValue = *std::max_element(scalarValues.cbegin(), scalarValues.cend());
-    std::vector<unsigned int> image;
-    image.reserve(scalarValues.size());
-    for (auto const x : scalarValues)
-        image.push_back(static_cast<unsigned int>(std::lroundf(x / maxValue * 255.0F)));
-
-
-    // Apply quantization to std::vector<unsigned int> image here.
-    // The variable m_quantizationBits ('n' in the lecture slides) is set in the GUI and can be used here.
-    // L needs to be set to the appropriate value and will be used to set the clamping range in the GUI.
-    // ..
-    unsigned int const L = pow(2, m_quantizationBits) - 1; // The number of colors that will be used to visualize the image.
-        float const colorRange = 255.0F / (float)(L + 1); // The range of each color, i.e. the subset of the range [0, 255] that represents one color.
-
-        for (size_t i = 0; i < image.size(); ++i) {
-            unsigned int colorIdx = (unsigned int) ( ((float) image[i]) / colorRange );
-            if (colorIdx > L) colorIdx = L; // Set values of 255 to the last color.
-            image[i] = colorIdx;
-        }
-
+    // The values are treated as an 8 bit image with pixel values in [0, 255], which is quantized into
+    // 2^n levels {0, 1, .., L}. The variable m_quantizationBits ('n' in the lecture slides) is set in the GUI.
+    float const maxValue = quantization::maximum(input.data(), input.size());
+    quantization::quantize(input.data(), output.data(), input.size(), maxValue, m_quantizationBits);
+    updateQuantizationClampingRange();
+}
 
-    // Convert the image's data back to floating point values, so that it can be processed as usual.
-    scalarValues = std::vector<float>{image.cbegin(), image.cend()};
+// Force the clamping range in the GUI to be [0, L]. Only done when L changes, so the user can still
+// adjust the range afterwards and the widgets are not updated on every frame.
+void Visualization::updateQuantizationClampingRange()
+{
+    unsigned int const L = quantization::maxLevel(m_quantizationBits);
+    if (L != m_quantizationClampedMaxLevel)
+    {
+        auto const mainWindowPtr = qobject_cast<MainWindow*>(parent()->parent());
+        Q_ASSERT(mainWindowPtr != nullptr);
+        mainWindowPtr->on_scalarDataMappingClampingMaxSlider_valueChanged(0);
+        mainWindowPtr->on_scalarDataMappingClampingMaxSlider_valueChanged(100 * static_cast<int>(L));
+        m_quantizationClampedMaxLevel = L;
+    }
+}
 
-    // Force the clamping range in the GUI to be [0, L].
-    auto const mainWindowPtr = qobject_cast<MainWindow*>(parent()->parent());
-    Q_ASSERT(mainWindowPtr != nullptr);
-    mainWindowPtr->on_scalarDataMappingClampingMaxSlider_valueChanged(0);
-    mainWindowPtr->on_scalarDataMappingClampingMaxSlider_valueChanged(100 * static_cast<int>(L));
+// The 8 bit counterpart of applyQuantization(): quantizes the input into m_quantizedLevels and uploads them.
+void Visualization::uploadQuantizedLevels(std::vector<float> const &input)
+{
+    float const maxValue = quantization::maximum(input.data(), input.size());
+    m_quantizedLevels.resize(input.size());
+    quantization::quantize(input.data(), m_quantizedLevels.data(), input.size(), maxValue, m_quantizationBits);
+
+    // The scaling range is taken from the levels, as the scalar values still hold the unquantized input.
+    auto const minMaxIt = std::minmax_element(m_quantizedLevels.cbegin(), m_quantizedLevels.cend());
+    m_quantizedLevelsMinMax = {static_cast<float>(*minMaxIt.first), static_cast<float>(*minMaxIt.second)};
+
+    // Unit 2, next to the color map (unit 0) and the space-time volume (unit 1).
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_quantizedLevelsTextureLocation);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows of any width are tightly packed.
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8,
+                 static_cast<GLsizei>(m_DIM), static_cast<GLsizei>(m_DIM),
+                 0, GL_RED, GL_UNSIGNED_BYTE, m_quantizedLevels.data());
+    glActiveTexture(GL_TEXTURE0);
+
+    updateQuantizationClampingRange();
 }
 
-void Visualization::convolute(std::vector<float> &scalarValues, std::vector<std::vector<float>> &kernel)
- //TODO add circular convolution?
- {
-    std::vector<float> input(scalarValues);
+void Visualization::setLevelsUniforms(QOpenGLShaderProgram &shaderProgram)
+{
+    // Always set, since samplers of different types may not share a texture unit.
+    shaderProgram.setUniformValue("levelsSampler", 2);
+    shaderProgram.setUniformValue("levelsTexture", static_cast<GLint>(m_levelsOnGpu));
+    if (m_levelsOnGpu)
+        shaderProgram.setUniformValue("DIM", static_cast<GLint>(m_DIM));
+}
 
-    // Fill output matrix: rows and columns are i and j respectively
-    for (unsigned long i = 0; i < m_DIM; ++i)
+void Visualization::applyGaussianBlur(std::vector<float> const &input, std::vector<float> &output)
+{
+    m_convolutionScratch.resize(input.size());
+    m_convolutionColumnSums.resize(m_DIM);
+
+    // Sigma 0 is the original blur: the 3x3 binomial kernel 1-2-1 / 16, as a 1-2-1 / 4 pass along each axis, with
+    // zeros outside the field like the original convolution.
+    // Other small sigmas use a sampled Gaussian kernel (radius 3 sigma) whose cost grows with sigma; there it is
+    // still cheap and more accurate than the box cascade, which costs the same for every sigma.
+    // Both only average the values inside the field, so the borders do not change at the switch.
+    float const maxKernelSigma = 3.0F;
+    if (m_gaussianBlurSigma <= maxKernelSigma)
     {
-         for (unsigned long j = 0; j < m_DIM; ++j)
-         {
-             float convoluteSum = 0.0F;
-
-            // Kernel rows and columns are k and l respectively
-             for (unsigned long k = 0; k < 3; ++k)
-             {
-                 for (unsigned long l = 0; l < 3; ++l)
-                {
-                     // Convolute here.
-                     if ((i == 0 && k == 0) || (i == m_DIM-1 && k == 2)) continue; // x value is out of bounds, so ignore this field
-                     if ((j == 0 && l == 0) || (j == m_DIM-1 && l == 2)) continue; // y value is out of bounds, so ignore this field
-                     unsigned long x = i + k - 1;
-                     unsigned long y = j + l - 1;
-                     convoluteSum += input[x + m_DIM * y] * kernel[k][l];
-                 }
-             }
-             scalarValues[i + m_DIM * j] = convoluteSum; // Add result to output matrix.
+        bool const binomial = m_gaussianBlurSigma <= 0.0F;
+        if (m_gaussianBlurKernelSigma != m_gaussianBlurSigma)
+        {
+            auto const radius = static_cast<size_t>(std::ceil(3.0F * m_gaussianBlurSigma));
+            m_gaussianBlurKernel = binomial ? std::vector<float>{0.25F, 0.5F, 0.25F}
+                                            : convolution::gaussianKernel(radius, m_gaussianBlurSigma);
+            m_gaussianBlurKernelSigma = m_gaussianBlurSigma;
         }
+        convolution::separable(input.data(), output.data(), m_convolutionScratch.data(), m_DIM, m_DIM,
+                               m_gaussianBlurKernel, m_gaussianBlurKernel,
+                               binomial ? convolution::Border::Zero : convolution::Border::Renormalize);
     }
- }
+    else
+        convolution::boxCascade(input.data(), output.data(), m_convolutionScratch.data(), m_convolutionColumnSums.data(),
+                                m_DIM, m_DIM, m_gaussianBlurSigma);
+}
 
+void Visualization::applyGradients(std::vector<float> const &input, std::vector<float> &output)
+{
+    // A single fused Sobel pass computes only the requested gradient quantity.
+    if (m_gradientOutput == GradientOutput::Magnitude)
+        convolution::sobel(input.data(), output.data(), nullptr, m_DIM, m_DIM);
+    else
+        convolution::sobel(input.data(), nullptr, output.data(), m_DIM, m_DIM);
+}
 
-void Visualization::applyGaussianBlur(std::vector<float> &scalarValues)
+void Visualization::applySlicing(std::vector<float> const &input, std::vector<float> &output)
 {
-    // Implement Gaussian blur here, applied on the values of the scalarValues container.
-    // First, define a 3x3 matrix for the kernel.
-    // (Use a C-style 2D array, a std::array of std::array's, or a std::vector of std::vectors)
+    // Update window: the input becomes the most recent layer of the volume.
+    // The texture does not get this layer, so it has to be uploaded as a whole before the GPU slices it again.
+    m_spaceTimeVolume.push(input.data());
+    m_spaceTimeVolumeTextureValid = false;
 
-    std::vector<std::vector<float>> kernel_gauss{{1.0/16,2.0/16,1.0/16}, {2.0/16,4.0/16,2.0/16}, {1.0/16,2.0/16,1.0/16}};
-    Visualization::convolute(scalarValues, kernel_gauss);
-}
+    switch (m_slicingDirection)
+    {
+    case SlicingDirection::x:
+        // xIdx is constant
+        m_spaceTimeVolume.sliceX(m_sliceIdx, output.data());
+        break;
 
-static inline double computeSquare (float x) {
-    return x*x;
+    case SlicingDirection::y:
+        // yIdx is constant
+        m_spaceTimeVolume.sliceY(m_sliceIdx, output.data());
+        break;
+
+    case SlicingDirection::t:
+        // t is constant. This is simply a 'regular' slice in time
+        m_spaceTimeVolume.sliceT(m_sliceIdx, output.data());
+        break;
+
+    case SlicingDirection::oblique:
+        m_spaceTimeVolume.sliceOblique(m_obliqueSliceAngle, m_sliceIdx, output.data());
+        break;
+    }
 }
 
-void Visualization::applyGradients(std::vector<float> &scalarValues)
+void Visualization::uploadSpaceTimeVolume()
 {
-    // Implement Gradient extraction here, applied on the values of the scalarValues container.
-    // First, define a 3x3 Sobel kernels (for x and y directions).
-    // (Use a C-style 2D array, a std::array of std::array's, or a std::vector of std::vectors)
-    std::vector<std::vector<float>> kernel_x{{1.0, 0.0, -1.0}, {2.0, 0.0, -2.0}, {1.0, 0.0, -1.0}}; // kernel to detect horizontal edges
-    std::vector<std::vector<float>> kernel_y{{1.0, 2.0, 1.0}, {0.0, 0.0, 0.0}, {-1.0, -2.0, -1.0}}; // kernel to detect vertical edges
-
-    // Convolve the values of the scalarValues container with the Sobel kernels
-    std::vector<float> output_x(scalarValues); // copy the values of scalarValues into output_x
-    std::vector<float> output_y(scalarValues);
-
-    Visualization::convolute(output_x, kernel_x); // store the approximate partial derivatives in the x direction into output_x
-    Visualization::convolute(output_y, kernel_y);
-
-    // Calculate the Gradient magnitude
-    // mag = sqrt((output_x)^2 + (output_y)^2)
-    std::vector<float> mag;
-    mag.reserve(output_x.size());
-    for (size_t i = 0; i < output_x.size(); ++i)
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, m_spaceTimeVolumeTextureLocation);
+
+    GLsizei const DIM = static_cast<GLsizei>(m_spaceTimeVolume.DIM());
+    if (m_spaceTimeVolumeTextureValid)
     {
-        float val = computeSquare(output_x[i]) + computeSquare(output_y[i]);
-        mag.push_back(val);
+        // Only the most recent layer changed.
+        glTexSubImage3D(GL_TEXTURE_3D, 0,
+                        0, 0, static_cast<GLint>(m_spaceTimeVolume.storageIdx(0U)),
+                        DIM, DIM, 1,
+                        GL_RED, GL_FLOAT, m_spaceTimeVolume.layer(0U));
     }
-
-    // Calculate the Gradient direction
-    // dir = tan-1(output_y/output_x);
-    std::vector<float> dir;
-    dir.reserve(output_x.size());
-    for (size_t i = 0; i < output_x.size(); ++i)
+    else
     {
-        float val = atan(output_y[i] / output_x[i]);
-        dir.push_back(val);
-    } // TODO dir currently not used
+        // Outside the grid the value is 0, like in the CPU slices. Along time the texture wraps around,
+        // just like the ring buffer, so the shaders do not need to know where the ring starts.
+        float const borderColor[4] = {0.0F, 0.0F, 0.0F, 0.0F};
+        glTexParameterfv(GL_TEXTURE_3D, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F,
+                     DIM, DIM, static_cast<GLsizei>(m_spaceTimeVolume.length()),
+                     0, GL_RED, GL_FLOAT, m_spaceTimeVolume.data());
+        m_spaceTimeVolumeTextureValid = true;
+    }
 
-    // apply the Gradient magnitude to the scalarValues.
-    std::copy(mag.begin(), mag.end(), scalarValues.begin());
+    glActiveTexture(GL_TEXTURE0);
 }
-void Visualization::applySlicing(std::vector<float> &scalarValues)
+
+// Sets the affine map from grid vertex (column, row) to volume texture coordinates for the current slice.
+// In texture coordinates, grid point x lies at (x + 0.5) / DIM and the layer with age a at (head + 0.5 - a) / T.
+// The sampler interpolates linearly, so unlike the CPU slices, which take the layer of age round(column * ageStep()),
+// it blends the two layers around column * ageStep() when T != DIM, and the oblique slice blends the grid points
+// around each sample instead of taking the nearest.
+void Visualization::setSliceUniforms(QOpenGLShaderProgram &shaderProgram)
 {
-    // Update window, the most recent scalar values are in index 0
-    m_scalarValuesWindow.pop_back();
-    m_scalarValuesWindow.push_front(scalarValues);
+    // The volume always uses texture unit 1; unit 0 holds the color map.
+    shaderProgram.setUniformValue("volumeSampler", 1);
+    shaderProgram.setUniformValue("sliceVolume", static_cast<GLint>(m_sliceOnGpu));
+    if (!m_sliceOnGpu)
+        return;
 
-    Q_ASSERT(m_sliceIdx < m_DIM);
+    float const DIM = static_cast<float>(m_spaceTimeVolume.DIM());
+    float const T = static_cast<float>(m_spaceTimeVolume.length());
+    float const cellStep = 1.0F / DIM;
+    float const newestLayer = (static_cast<float>(m_spaceTimeVolume.storageIdx(0U)) + 0.5F) / T;
+    float const ageStep = -m_spaceTimeVolume.ageStep() / T;
+    float const sliceCoordinate = (static_cast<float>(m_sliceIdx) + 0.5F) * cellStep;
 
-    std::vector<float> tmp;
+    QVector3D origin;
+    QVector3D columnStep;
+    QVector3D rowStep;
     switch (m_slicingDirection)
     {
     case SlicingDirection::x:
-        // xIdx is constant
-        for (size_t yIdx = 0U; yIdx < m_DIM; ++yIdx)
-            for (size_t tIdx = 0U; tIdx < m_DIM; ++tIdx)
-                tmp.push_back(m_scalarValuesWindow[tIdx][m_DIM * yIdx + m_sliceIdx]);
+        origin = {sliceCoordinate, 0.5F * cellStep, newestLayer};
+        columnStep = {0.0F, 0.0F, ageStep};
+        rowStep = {0.0F, cellStep, 0.0F};
         break;
 
     case SlicingDirection::y:
-        // yIdx is constant
-        for (size_t xIdx = 0U; xIdx < m_DIM; ++xIdx)
-            for (size_t tIdx = 0U; tIdx < m_DIM; ++tIdx)
-                tmp.push_back(m_scalarValuesWindow[tIdx][m_DIM * m_sliceIdx + xIdx]);
+        origin = {0.5F * cellStep, sliceCoordinate, newestLayer};
+        columnStep = {0.0F, 0.0F, ageStep};
+        rowStep = {cellStep, 0.0F, 0.0F};
         break;
 
     case SlicingDirection::t:
-        // t is constant. This is simply a 'regular' slice in time
-        tmp = m_scalarValuesWindow[m_sliceIdx];
+    {
+        float const age = std::min(static_cast<float>(m_sliceIdx), T - 1.0F);
+        origin = {0.5F * cellStep, 0.5F * cellStep, newestLayer - age / T};
+        columnStep = {cellStep, 0.0F, 0.0F};
+        rowStep = {0.0F, cellStep, 0.0F};
+        break;
+    }
+
+    case SlicingDirection::oblique:
+    {
+        // See SpaceTimeVolume::sliceOblique(), in texture coordinates.
+        float const angle = qDegreesToRadians(m_obliqueSliceAngle);
+        QVector2D const direction{std::sin(angle), std::cos(angle)};
+        QVector2D const normal{direction.y(), -direction.x()};
+        QVector2D const first = QVector2D{0.5F, 0.5F} + (sliceCoordinate - 0.5F) * normal + (0.5F * cellStep - 0.5F) * direction;
+
+        origin = {first.x(), first.y(), newestLayer};
+        columnStep = {0.0F, 0.0F, ageStep};
+        rowStep = {cellStep * direction.x(), cellStep * direction.y(), 0.0F};
         break;
     }
+    }
+
+    shaderProgram.setUniformValue("DIM", static_cast<GLint>(m_spaceTimeVolume.DIM()));
+    shaderProgram.setUniformValue("sliceOrigin", origin);
+    shaderProgram.setUniformValue("sliceColumnStep", columnStep);
+    shaderProgram.setUniformValue("sliceRowStep", rowStep);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, m_spaceTimeVolumeTextureLocation);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Visualization::applyPreprocessingStage(PreprocessingStage const stage, std::vector<float> const &input,
+                                            std::vector<float> &output)
+{
+    switch (stage)
+    {
+        case PreprocessingStage::Quantization:
+            applyQuantization(input, output);
+        break;
+
+        case PreprocessingStage::GaussianBlur:
+            applyGaussianBlur(input, output);
+        break;
+
+        case PreprocessingStage::Gradients:
+            applyGradients(input, output);
+        break;
 
-    scalarValues = tmp;
+        case PreprocessingStage::Slicing:
+            applySlicing(input, output);
+        break;
+    }
 }
+
 void Visualization::applyPreprocessing(std::vector<float> &scalarValues)
 {
-    if (m_useQuantization)
-        applyQuantization(scalarValues);
+    m_sliceOnGpu = false;
+    m_levelsOnGpu = false;
+    if (m_preprocessingStages.empty())
+        return;
 
-    if (m_useGaussianBlur)
-        applyGaussianBlur(scalarValues);
+    Q_ASSERT(m_preprocessingStageTimings.size() == m_preprocessingStages.size());
 
-    if (m_useGradients)
-        applyGradients(scalarValues);
+    // A final slicing stage can be left to the GPU: it only has to add the values to the window.
+    m_sliceOnGpu = m_useGpuSlicing && m_preprocessingStages.back() == PreprocessingStage::Slicing;
+    // A final quantization stage can hand its levels to the GPU as 8 bit texels instead of floats.
+    m_levelsOnGpu = m_useLevelsTexture && m_preprocessingStages.back() == PreprocessingStage::Quantization;
+    size_t const numberOfCpuStages = m_preprocessingStages.size() - (m_sliceOnGpu || m_levelsOnGpu ? 1U : 0U);
 
-    if (m_useSlicing)
-        applySlicing(scalarValues);
+    // Every stage maps m_DIM * m_DIM values to m_DIM * m_DIM values, so the buffer only grows when m_DIM does.
+    m_preprocessingBuffer.resize(scalarValues.size());
+    std::vector<float> *input = &scalarValues;
+    std::vector<float> *output = &m_preprocessingBuffer;
+
+    QElapsedTimer timer;
+    for (size_t idx = 0U; idx < m_preprocessingStages.size(); ++idx)
+    {
+        timer.start();
+        if (idx < numberOfCpuStages)
+        {
+            applyPreprocessingStage(m_preprocessingStages[idx], *input, *output);
+            std::swap(input, output);
+        }
+        else if (m_sliceOnGpu)
+        {
+            m_spaceTimeVolume.push(input->data());
+            uploadSpaceTimeVolume();
+        }
+        else
+        {
+            uploadQuantizedLevels(*input);
+        }
+        double const milliseconds = static_cast<double>(timer.nsecsElapsed()) / 1.0e6;
+
+        // Exponential smoothing keeps the timings readable in the GUI.
+        m_preprocessingStageTimings[idx] = 0.9 * m_preprocessingStageTimings[idx] + 0.1 * milliseconds;
+    }
+
+    // The result is in *input. Exchanging the storage hands it over without copying.
+    if (input != &scalarValues)
+        std::swap(scalarValues, m_preprocessingBuffer);
+}
+
+void Visualization::sendPreprocessingStageTimingsToUI()
+{
+    if (m_preprocessingStages.empty())
+        return;
+
+    auto const mainWindowPtr = qobject_cast<MainWindow*>(parent()->parent());
+    Q_ASSERT(mainWindowPtr != nullptr);
+    mainWindowPtr->setPreprocessingStageTimings(m_preprocessingStageTimings);
 }
 
 void Visualization::drawScalarData()
@@ -691,13 +885,12 @@ void Visualization::drawScalarData()
             if (m_useCustomColorMap)
             {
                 m_shaderProgramScalarDataScaleCustomColorMap.bind();
+                setSliceUniforms(m_shaderProgramScalarDataScaleCustomColorMap);
+                setLevelsUniforms(m_shaderProgramScalarDataScaleCustomColorMap);
                 glUniformMatrix4fv(m_uniformLocationScalarDataScaleCustomColorMap_projection, 1, GL_FALSE, m_projectionTransformationMatrix.data());
 
-                auto const currentMinMaxIt = std::minmax_element(scalarValues.cbegin(), scalarValues.cend());
-                QVector2D currentMinMax{*currentMinMaxIt.first, *currentMinMaxIt.second};
-
-                m_minMaxDensity.update(currentMinMax);
-                QVector2D const minMaxAverage{m_minMaxDensity.average()};
+                QVector2D const minMaxAverage{m_levelsOnGpu ? updateScalingRange(m_quantizedLevelsMinMax)
+                                                            : updateScalingRange(scalarValues)};
 
                 // Send values to GUI.
                 if (m_sendMinMaxToUI)
@@ -718,13 +911,12 @@ void Visualization::drawScalarData()
             else
             {
                 m_shaderProgramScalarDataScaleTexture.bind();
+                setSliceUniforms(m_shaderProgramScalarDataScaleTexture);
+                setLevelsUniforms(m_shaderProgramScalarDataScaleTexture);
                 glUniformMatrix4fv(m_uniformLocationScalarDataScaleTexture_projection, 1, GL_FALSE, m_projectionTransformationMatrix.data());
 
-                auto const currentMinMaxIt = std::minmax_element(scalarValues.cbegin(), scalarValues.cend());
-                QVector2D currentMinMax{*currentMinMaxIt.first, *currentMinMaxIt.second};
-
-                m_minMaxDensity.update(currentMinMax);
-                QVector2D const minMaxAverage{m_minMaxDensity.average()};
+                QVector2D const minMaxAverage{m_levelsOnGpu ? updateScalingRange(m_quantizedLevelsMinMax)
+                                                            : updateScalingRange(scalarValues)};
 
                 // Send values to GUI.
                 if (m_sendMinMaxToUI)
@@ -751,6 +943,8 @@ void Visualization::drawScalarData()
             if (m_useCustomColorMap)
             {
                 m_shaderProgramScalarDataClampCustomColorMap.bind();
+                setSliceUniforms(m_shaderProgramScalarDataClampCustomColorMap);
+                setLevelsUniforms(m_shaderProgramScalarDataClampCustomColorMap);
                 glUniformMatrix4fv(m_uniformLocationScalarDataClampCustomColorMap_projection, 1, GL_FALSE, m_projectionTransformationMatrix.data());
 
                 // Send values to GUI.
@@ -772,6 +966,8 @@ void Visualization::drawScalarData()
             else
             {
                 m_shaderProgramScalarDataClampTexture.bind();
+                setSliceUniforms(m_shaderProgramScalarDataClampTexture);
+                setLevelsUniforms(m_shaderProgramScalarDataClampTexture);
                 glUniformMatrix4fv(m_uniformLocationScalarDataClampTexture_projection, 1, GL_FALSE, m_projectionTransformationMatrix.data());
 
                 // Send values to GUI.
@@ -797,12 +993,15 @@ void Visualization::drawScalarData()
 
     glBindVertexArray(m_vaoScalarData);
 
-    // Copy scalars to GPU buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboScalarData);
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    0,
-                    static_cast<GLsizeiptr>(scalarValues.size() * sizeof(float)),
-                    scalarValues.data());
+    // Copy scalars to GPU buffer, unless the shaders read the levels from their texture.
+    if (!m_levelsOnGpu)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vboScalarData);
+        glBufferSubData(GL_ARRAY_BUFFER,
+                        0,
+                        static_cast<GLsizeiptr>(scalarValues.size() * sizeof(float)),
+                        scalarValues.data());
+    }
 
     glDrawElements(GL_TRIANGLE_STRIP,
                    static_cast<GLsizei>(m_indices.size()),
@@ -810,6 +1009,25 @@ void Visualization::drawScalarData()
                    static_cast<GLvoid*>(nullptr));
 }
 
+// Feeds the current min/max into both range trackers and returns the range used for scaling.
+QVector2D Visualization::updateScalingRange(std::vector<float> const &scalarValues)
+{
+    auto const currentMinMaxIt = std::minmax_element(scalarValues.cbegin(), scalarValues.cend());
+    return updateScalingRange(QVector2D{*currentMinMaxIt.first, *currentMinMaxIt.second});
+}
+
+// Same, given the current min/max.
+QVector2D Visualization::updateScalingRange(QVector2D const &currentMinMax)
+{
+    m_minMaxDensity.update(currentMinMax);
+    m_minMaxDensityExtrema.update(currentMinMax.x(), currentMinMax.y());
+
+    if (m_useSlidingExtrema)
+        return {m_minMaxDensityExtrema.min(), m_minMaxDensityExtrema.max()};
+
+    return m_minMaxDensity.average();
+}
+
 void Visualization::drawIsolines()
 {
        
@@ -846,35 +1064,49 @@ void Visualization::drawIsolines()
         break;
     }
 
+    if (scalarValues.empty())
+        return;
 
+    m_isovalues.resize(m_numberOfIsolines);
     for (size_t n = 0U; n < m_numberOfIsolines; ++n)
-    {
-        float const currentIsolineValue = m_isolineMinValue + (n * stepsize);
-        std::vector<QVector2D> const vertices{Isoline(scalarValues,
-                                                      m_DIM,
-                                                      currentIsolineValue,
-                                                      m_cellWidth,
-                                                      m_isolineInterpolationMethod).vertices()};
-
-        std::vector<QVector3D> isolineVertices;
-        isolineVertices.reserve(vertices.size());
-        for (auto const &v : vertices)
-            isolineVertices.emplace_back(v, 0.0F);
+        m_isovalues[n] = m_isolineMinValue + (n * stepsize);
+    std::sort(m_isovalues.begin(), m_isovalues.end());
 
-        glBindVertexArray(m_vaoIsolines);
+    m_marchingSquares.extract(scalarValues, m_DIM, m_isovalues, m_cellWidth, m_isolineInterpolationMethod,
+                              m_isolineOutputMode);
+    std::vector<IsolineVertex> const &vertices = m_marchingSquares.vertices();
 
-
-        // buffer data and draw lines
-        glBindBuffer(GL_ARRAY_BUFFER, m_vboIsolines);
+    // The buffer keeps its storage between frames and only grows, by at least a factor 2, when the vertices don't fit.
+    glBindVertexArray(m_vaoIsolines);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vboIsolines);
+    if (vertices.size() > m_isolineVertexCapacity)
+    {
+        m_isolineVertexCapacity = std::max(vertices.size(), 2U * m_isolineVertexCapacity);
         glBufferData(GL_ARRAY_BUFFER,
-                     static_cast<GLsizeiptr>(isolineVertices.size() * sizeof(QVector3D)),
-                     isolineVertices.data(),
+                     static_cast<GLsizeiptr>(m_isolineVertexCapacity * sizeof(IsolineVertex)),
+                     nullptr,
                      GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(vertices.size() * sizeof(IsolineVertex)), vertices.data());
 
-	
-        glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(isolineVertices.size()));
+    // Every vertex carries its isovalue, so all isolines are drawn with one call.
+    if (m_isolineOutputMode == MarchingSquares::OutputMode::Segments)
+    {
+        glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(vertices.size()));
+        return;
+    }
 
+    std::vector<size_t> const &polylineOffsets = m_marchingSquares.polylineOffsets();
+    size_t const numberOfPolylines = polylineOffsets.size() - 1U;
+    m_isolineFirsts.resize(numberOfPolylines);
+    m_isolineCounts.resize(numberOfPolylines);
+    for (size_t n = 0U; n < numberOfPolylines; ++n)
+    {
+        m_isolineFirsts[n] = static_cast<GLint>(polylineOffsets[n]);
+        m_isolineCounts[n] = static_cast<GLsizei>(polylineOffsets[n + 1U] - polylineOffsets[n]);
     }
+
+    glMultiDrawArrays(GL_LINE_STRIP, m_isolineFirsts.data(), m_isolineCounts.data(), static_cast<GLsizei>(numberOfPolylines));
 }
 
 void Visualization::drawHeightplot()
@@ -940,11 +1172,7 @@ void Visualization::drawHeightplot()
             glUniform4fv(m_uniformLocationHeightplotScale_material, 1, &m_materialConstants[0]);
             glUniform3fv(m_uniformLocationHeightplotScale_light, 1, &m_lightPosition[0]);
 
-            auto const currentMinMaxIt = std::minmax_element(scalarValues.cbegin(), scalarValues.cend());
-            QVector2D currentMinMax{*currentMinMaxIt.first, *currentMinMaxIt.second};
-
-            m_minMaxDensity.update(currentMinMax);
-            QVector2D const minMaxAverage{m_minMaxDensity.average()};
+            QVector2D const minMaxAverage{updateScalingRange(scalarValues)};
 
             // Send values to GUI.
             if (m_sendMinMaxToUI)
@@ -1025,19 +1253,30 @@ void Visualization::drawHeightplot()
                    static_cast<GLvoid*>(nullptr));
 }
 
-std::vector<QVector3D> Visualization::computeNormals(std::vector<float> heights)
+std::vector<QVector3D> Visualization::computeNormals(std::vector<float> const &heights)
 {
-    std::vector<std::vector<float>> kernel_x{{1.0, 0.0, -1.0}, {2.0, 0.0, -2.0}, {1.0, 0.0, -1.0}}; // kernel to detect horizontal edges
-    std::vector<std::vector<float>> kernel_y{{1.0, 2.0, 1.0}, {0.0, 0.0, 0.0}, {-1.0, -2.0, -1.0}}; // kernel to detect vertical edges
-
-    std::vector<float> scalarValues(heights); // copy the values of scalarValues into output_x
-    std::vector<float> heightValues(heights);
-
-    Visualization::convolute(scalarValues, kernel_x); // store the approximate partial derivatives in the x direction into output_x
-    Visualization::convolute(heightValues, kernel_y);
-   std::vector<QVector3D> qVec = std::vector<QVector3D>(scalarValues.begin(), scalarValues.end());
-
-    return qVec;
+    m_convolutionScratch.resize(heights.size());
+    m_convolutionOutputX.resize(heights.size());
+    m_convolutionOutputY.resize(heights.size());
+
+    // Sobel derivatives along x and y. Both are -8 times the height difference per cell.
+    convolution::separable(heights.data(), m_convolutionOutputX.data(), m_convolutionScratch.data(), m_DIM, m_DIM,
+                           convolution::sobelDerivativeKernel, convolution::sobelSmoothingKernel);
+    convolution::separable(heights.data(), m_convolutionOutputY.data(), m_convolutionScratch.data(), m_DIM, m_DIM,
+                           convolution::sobelSmoothingKernel, convolution::sobelDerivativeKernel);
+
+    // The normal of the surface z = h(x, y) is (-dh/dx, -dh/dy, 1).
+    float const scaleX = 1.0F / (8.0F * m_cellWidth);
+    float const scaleY = 1.0F / (8.0F * m_cellHeight);
+
+    std::vector<QVector3D> normals;
+    normals.reserve(heights.size());
+    for (size_t idx = 0U; idx < heights.size(); ++idx)
+        normals.push_back(QVector3D{m_convolutionOutputX[idx] * scaleX,
+                                    m_convolutionOutputY[idx] * scaleY,
+                                    1.0F}.normalized());
+
+    return normals;
 }
 
 // drag: When the user drags with the mouse, add a force that corresponds to the direction of the mouse
@@ -1090,6 +1329,8 @@ void Visualization::setDIM(size_t const DIM)
     m_timer.stop();
 
     m_DIM = DIM;
+    m_spaceTimeVolume.resize(m_DIM, m_spaceTimeVolume.length());
+    m_spaceTimeVolumeTextureValid = false;
     setupAllBuffers();
     resizeGL(width(), height());
     m_simulation.setDIM(m_DIM);
@@ -3,9 +3,11 @@
 
 #include "color.h"
 #include "datatype.h"
-#include "isoline.h"
+#include "marchingsquares.h"
 #include "movingaverage.h"
+#include "movingminmax.h"
 #include "simulation.h"
+#include "spacetimevolume.h"
 #include "texture.h"
 
 #include <QOpenGLWidget>
@@ -15,7 +17,7 @@
 #include <QOpenGLShaderProgram>
 
 #include <array>
-#include <deque>
+#include <cstdint>
 #include <utility>
 #include <vector>
 
@@ -35,10 +37,27 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     {
         x,
         y,
-        t
+        t,
+        oblique
+    };
+
+    // The values match the indices of the stage combobox in the GUI.
+    enum class PreprocessingStage
+    {
+        Quantization,
+        GaussianBlur,
+        Gradients,
+        Slicing
+    };
+
+    enum class GradientOutput
+    {
+        Magnitude,
+        Direction
     };
 
     QTimer m_timer;
+    QTimer m_preprocessingTimingsTimer;
     QOpenGLDebugLogger m_debugLogger;
 
     //--- VISUALIZATION PARAMETERS ---------------------------------------------------------------------
@@ -70,17 +89,24 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     ScalarDataType m_currentIsolineDataType = ScalarDataType::Density;
     bool m_manuallyChooseIsolineDataType = false;
     size_t m_numberOfIsolines = 1U;
-    Isoline::InterpolationMethod m_isolineInterpolationMethod = Isoline::InterpolationMethod::Linear;
+    MarchingSquares::InterpolationMethod m_isolineInterpolationMethod = MarchingSquares::InterpolationMethod::Linear;
     float m_isolineMinValue = 0.5F;
     float m_isolineMaxValue = 0.5F;
     QVector3D m_isolineColor{1.0F, 1.0F, 1.0F};
+    MarchingSquares::OutputMode m_isolineOutputMode = MarchingSquares::OutputMode::Segments;
+    MarchingSquares m_marchingSquares;
+    std::vector<float> m_isovalues;
+    std::vector<GLint> m_isolineFirsts;     // Polyline mode: first vertex and vertex count of every line strip.
+    std::vector<GLsizei> m_isolineCounts;
+    bool m_colorIsolinesByValue = false;    // Color every isoline by its isovalue instead of m_isolineColor.
+    size_t m_isolineVertexCapacity = 0U;    // Number of vertices m_vboIsolines has room for.
 
     // Height plot info
     ScalarDataType m_currentHeightplotDataType = ScalarDataType::Density;
     QVector3D m_rotation{45.0F, 0.0F, 0.0F};
 
     // Functions
-    std::vector<QVector3D> computeNormals(std::vector<float> height);
+    std::vector<QVector3D> computeNormals(std::vector<float> const &heights);
 
     void drag(int const mx, int my);
 
@@ -138,6 +164,10 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 
     GLint m_uniformLocationIsolines_projection;
     GLint m_uniformLocationIsolines_color;
+    GLint m_uniformLocationIsolines_isovalueMin;
+    GLint m_uniformLocationIsolines_isovalueMax;
+    GLint m_uniformLocationIsolines_useColorMap;
+    GLint m_uniformLocationIsolines_texture;
 
     GLint m_uniformLocationHeightplotScale_rangeMin;
     GLint m_uniformLocationHeightplotScale_rangeMax;
@@ -171,32 +201,72 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     QVector3D m_lightPosition{300.0F, 300.0F, 200.0F};
 
     MovingAverage<QVector2D> m_minMaxDensity{60, {0.0F, 0.0F}};
-
+    MovingMinMax<float> m_minMaxDensityExtrema{60, 0.0F};
+    bool m_useSlidingExtrema = false;   // Scale with the sliding min/max instead of the averaged min/max.
+
+    QVector2D updateScalingRange(std::vector<float> const &scalarValues);
+    QVector2D updateScalingRange(QVector2D const &currentMinMax);
+
+    // Preprocessing pipeline. The stages run in order and each stage may occur any number of times.
+    // Every stage reads its input from one buffer and writes its output to the other (ping-pong),
+    // so after the first frame the pipeline runs without allocating.
+    std::vector<PreprocessingStage> m_preprocessingStages;
+    std::vector<double> m_preprocessingStageTimings;    // Smoothed duration of every stage, in milliseconds.
+    std::vector<float> m_preprocessingBuffer;           // Ping-pong partner of the scalar values.
     void applyPreprocessing(std::vector<float> &scalarValues);
+    void applyPreprocessingStage(PreprocessingStage const stage, std::vector<float> const &input, std::vector<float> &output);
 
     // Quantization
-    bool m_useQuantization = false;
-    unsigned int m_quantizationBits = 2U;
-    void applyQuantization(std::vector<float> &scalarValues);
+    unsigned int m_quantizationBits = 1U;
+    unsigned int m_quantizationClampedMaxLevel = 0U; // The L the clamping range was last set to, 0 if none.
+    void applyQuantization(std::vector<float> const &input, std::vector<float> &output);
+    void updateQuantizationClampingRange();
+
+    // 8 bit levels: a final quantization stage can hand its levels to the GPU as a GL_R8 texture, a quarter of the
+    // floats the vertex buffer takes, from which the scalar data vertex shaders read them. Only used when quantization
+    // is the last stage, since later stages need the levels on the CPU.
+    bool m_useLevelsTexture = false;
+    bool m_levelsOnGpu = false;                         // Whether the current frame reads the levels from the texture.
+    std::vector<uint8_t> m_quantizedLevels;
+    QVector2D m_quantizedLevelsMinMax;
+    GLuint m_quantizedLevelsTextureLocation;
+    void uploadQuantizedLevels(std::vector<float> const &input);
+    void setLevelsUniforms(QOpenGLShaderProgram &shaderProgram);
+
+    // Scratch buffers for the separable convolutions, reused between frames.
+    std::vector<float> m_convolutionScratch;
+    std::vector<float> m_convolutionOutputX;
+    std::vector<float> m_convolutionOutputY;
+    std::vector<float> m_convolutionColumnSums;
+    std::vector<float> m_gaussianBlurKernel;            // Rebuilt only when m_gaussianBlurSigma changes.
+    float m_gaussianBlurKernelSigma = -1.0F;            // The sigma m_gaussianBlurKernel was built for.
 
     // Gaussian blur
-    bool m_useGaussianBlur = false;
- void convolute(std::vector<float> &input, std::vector<std::vector<float>> &kernel);
-    void applyGaussianBlur(std::vector<float> &scalarValues);
+    float m_gaussianBlurSigma = 0.0F; // Standard deviation in cells; 0 selects the original 3x3 binomial kernel.
+    void applyGaussianBlur(std::vector<float> const &input, std::vector<float> &output);
 
     // Gradients
-    bool m_useGradients = false;
-    void applyGradients(std::vector<float> &scalarValues);
+    GradientOutput m_gradientOutput = GradientOutput::Magnitude;
+    void applyGradients(std::vector<float> const &input, std::vector<float> &output);
     std::vector<QVector3D> hsv2rgb(std::vector<QVector3D> c);
 
     // Slicing
-    bool m_useSlicing = false;
-    size_t const m_slicingWindowSize = m_DIM;
     SlicingDirection m_slicingDirection = SlicingDirection::x;
     size_t m_sliceIdx = 0U;
-    std::deque<std::vector<float>> m_scalarValuesWindow{m_slicingWindowSize, std::vector<float>(m_DIM * m_DIM, 0.0F)};
+    SpaceTimeVolume m_spaceTimeVolume{m_DIM, m_DIM};   // The window of the last (by default DIM) time steps.
+    float m_obliqueSliceAngle = 0.0F;                   // In degrees, see SpaceTimeVolume::sliceOblique().
+
+    // GPU slicing: the window is mirrored in a 3D texture that receives one layer per time step, and the
+    // scalar data vertex shaders sample the slice from it. Only used when slicing is the last stage, since
+    // later stages need the slice on the CPU.
+    bool m_useGpuSlicing = false;
+    bool m_sliceOnGpu = false;                          // Whether the current frame is sliced on the GPU.
+    bool m_spaceTimeVolumeTextureValid = false;         // False when the texture has to be uploaded as a whole.
+    GLuint m_spaceTimeVolumeTextureLocation;
+    void uploadSpaceTimeVolume();
+    void setSliceUniforms(QOpenGLShaderProgram &shaderProgram);
 
-    void applySlicing(std::vector<float> &scalarValues);
+    void applySlicing(std::vector<float> const &input, std::vector<float> &output);
 
 
     // Indices used in OpenGL indexed rendering
@@ -214,6 +284,7 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     void createShaderProgramHeightplotClamp();
 
     void loadScalarDataTexture(std::vector<Color> const &colorMap);
+    void loadIsolinesTexture(std::vector<Color> const &colorMap);
 
     void setupAllBuffers();
     void setupScalarData();
@@ -236,6 +307,7 @@ protected:
 
 private slots:
     void onMessageLogged(QOpenGLDebugMessage const &Message) const;
+    void sendPreprocessingStageTimingsToUI();
 
 public slots:
     void do_one_simulation_step();
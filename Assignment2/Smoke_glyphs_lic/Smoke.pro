@@ -22,6 +22,7 @@ CONFIG += c++17
 
 SOURCES += \
         glyph.cpp \
+        interpolation.cpp \
         legend.cpp \
         lic.cpp \
         main.cpp \
@@ -49,6 +50,8 @@ HEADERS += \
         lic.h \
         mainwindow.h \
         movingaverage.h \
+        parallel.h \
+        simd.h \
         simulation.h \
         texture.h \
         visualization.h
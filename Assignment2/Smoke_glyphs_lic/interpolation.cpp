@@ -0,0 +1,120 @@
+#include "interpolation.h"
+
+#include "simd.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+
+namespace
+{
+    // Input position of output sample n of numberOfSamples, see SquareResampler.
+    float inputPosition(size_t const n, size_t const numberOfSamples, size_t const sideSize)
+    {
+        float const position = static_cast<float>((n + 1U) * (sideSize + 1U)) / static_cast<float>(numberOfSamples + 1U) - 1.0F;
+        return std::clamp(position, 0.0F, static_cast<float>(sideSize - 1U));
+    }
+
+#ifdef SIMD_AVX2
+    // Interpolates blendedRow at the output columns from x = 0 on, eight at a time. Returns the first output left for the scalar loop.
+    SIMD_AVX2_TARGET size_t interpolateRowAvx2(float const *blendedRow, int32_t const *columns, float const *columnWeights,
+                                               float *outputRow, size_t const xMax)
+    {
+        size_t x = 0U;
+        for (; x + 8U <= xMax; x += 8U)
+        {
+            __m256i const columnIndices = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(columns + x));
+            __m256 const left = _mm256_i32gather_ps(blendedRow, columnIndices, 4);
+            __m256 const right = _mm256_i32gather_ps(blendedRow + 1, columnIndices, 4);
+            __m256 const weights = _mm256_loadu_ps(columnWeights + x);
+            _mm256_storeu_ps(outputRow + x, _mm256_fmadd_ps(weights, _mm256_sub_ps(right, left), left));
+        }
+        return x;
+    }
+#endif
+}
+
+namespace interpolation
+{
+    void SquareResampler::setSizes(size_t const sideSize, size_t const xMax, size_t const yMax)
+    {
+        Q_ASSERT(sideSize > 0U);
+
+        if (sideSize == m_sideSize && xMax == m_xMax && yMax == m_yMax)
+            return;
+
+        m_sideSize = sideSize;
+        m_xMax = xMax;
+        m_yMax = yMax;
+
+        m_columns.resize(xMax);
+        m_columnWeights.resize(xMax);
+        for (size_t x = 0U; x < xMax; ++x)
+        {
+            float const position = inputPosition(x, xMax, sideSize);
+            m_columns[x] = static_cast<int32_t>(position);
+            m_columnWeights[x] = position - static_cast<float>(m_columns[x]);
+        }
+
+        m_rows.resize(yMax);
+        m_nextRows.resize(yMax);
+        m_rowWeights.resize(yMax);
+        for (size_t y = 0U; y < yMax; ++y)
+        {
+            float const position = inputPosition(y, yMax, sideSize);
+            m_rows[y] = static_cast<size_t>(static_cast<int32_t>(position));
+            m_nextRows[y] = std::min(m_rows[y] + 1U, sideSize - 1U);
+            m_rowWeights[y] = position - static_cast<float>(m_rows[y]);
+        }
+
+        // The right column of the last input column is its copy at the end, with weight 0.
+        m_blendedRow.resize(sideSize + 1U);
+    }
+
+    void SquareResampler::blendRows(float const *values, size_t const y)
+    {
+        size_t const sideSize = m_sideSize;
+        float const *bottom = values + sideSize * m_rows[y];
+        float const *top = values + sideSize * m_nextRows[y];
+        float const rowWeight = m_rowWeights[y];
+        float *blendedRow = m_blendedRow.data();
+
+        // Plain loop over contiguous values, which the compiler vectorizes.
+        for (size_t x = 0U; x < sideSize; ++x)
+            blendedRow[x] = bottom[x] + rowWeight * (top[x] - bottom[x]);
+        blendedRow[sideSize] = blendedRow[sideSize - 1U];
+    }
+
+    void SquareResampler::interpolateRow(float *outputRow) const
+    {
+        float const *blendedRow = m_blendedRow.data();
+
+        size_t x = 0U;
+#ifdef SIMD_AVX2
+        if (simd::hasAvx2())
+            x = interpolateRowAvx2(blendedRow, m_columns.data(), m_columnWeights.data(), outputRow, m_xMax);
+#endif
+        for (; x < m_xMax; ++x)
+        {
+            float const left = blendedRow[m_columns[x]];
+            float const right = blendedRow[m_columns[x] + 1];
+            outputRow[x] = left + m_columnWeights[x] * (right - left);
+        }
+    }
+
+    void SquareResampler::resample(float const *values, float *output)
+    {
+        for (size_t y = 0U; y < m_yMax; ++y)
+        {
+            blendRows(values, y);
+            interpolateRow(output + m_xMax * y);
+        }
+    }
+
+    void resampleSquare(float const *values, size_t const sideSize, size_t const xMax, size_t const yMax, float *output)
+    {
+        thread_local SquareResampler resampler;
+        resampler.setSizes(sideSize, xMax, yMax);
+        resampler.resample(values, output);
+    }
+}
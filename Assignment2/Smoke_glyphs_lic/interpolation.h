@@ -1,63 +1,84 @@
 #ifndef INTERPOLATION_H
 #define INTERPOLATION_H
 
-#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
-#include <QDebug>
-
 namespace interpolation
 {
-    /* Input
-     * values: You may assume this is of the type std::vector<float>. This contains the values (e.g. densities) to be interpolated.
-     * sideSize: The input size of the square matrix "values". This is equal to m_DIM in the Simulation and Visualization classes.
-     * xMax, yMax: The desired dimensions of the output vector. xMax is the horizontal size (number of columns), yMax is the vertical size (number of rows).
+    /* Separable bilinear resampling of a row-major sideSize x sideSize grid to a row-major xMax x yMax grid.
      *
-     * Output
-     * interpolatedValues: A 1D row-mayor container of std::vector<float> type containing the interpolated values.
+     * Both grids span the same square the way Visualization draws them: point n of an m-point axis lies at
+     * (n + 1) / (m + 1) of the way across, so sample n takes the input at (n + 1) * (sideSize + 1) / (m + 1) - 1,
+     * clamped to the input. With xMax == yMax == sideSize the input comes out unchanged.
+     *
+     * The input positions only depend on the sizes, so the input column and weight of every output column and the
+     * input rows and weight of every output row are computed once into tables, which are kept while the sizes stay
+     * the same. Every output row then blends its two input rows into one, and every output column interpolates
+     * within that row, eight columns at a time with AVX2 where the CPU supports it.
      */
-    template <typename inVector>
-    std::vector<float> interpolateSquareVector(inVector const &values, size_t const sideSize, size_t const xMax, size_t const yMax)
+    class SquareResampler
     {
-        std::vector<float> interpolatedValues;
-        
-        // Prepare conversion from sideSize x sideSize matrix 'values' to a xMax x yMax grid 'interpolatedValues'.
-        interpolatedValues.resize(xMax * yMax);
+        size_t m_sideSize = 0U;
+        size_t m_xMax = 0U;
+        size_t m_yMax = 0U;
 
-        float const cellWidth = static_cast<float>(sideSize) / static_cast<float>(xMax+1); // The number of columns of "values" per glyph
-        float const cellHeight = static_cast<float>(sideSize) / static_cast<float>(yMax+1); // The number of rows of "values" per glyph
+        std::vector<int32_t> m_columns;         // Left input column of every output column; the right one is next to it.
+        std::vector<float> m_columnWeights;     // Weight of the right column.
+        std::vector<size_t> m_rows;             // Bottom input row of every output row.
+        std::vector<size_t> m_nextRows;         // Top input row, which is the bottom one at the top edge.
+        std::vector<float> m_rowWeights;        // Weight of the top row.
+        std::vector<float> m_blendedRow;        // The blended input row, with the last value repeated once.
+        std::vector<float> m_outputRows;        // resampleVector(): one output row of each component.
 
-        // Convert the sideSize x sideSize matrix 'values' to an xMax x yMax grid 'interpolatedValues'.
-        for(float i = 0.0F; i < xMax; ++i)
-        {
-            for(float j = 0.0F; j < yMax; ++j)
-            {
-                // Bilinear interpolation via the weighted mean: https://en.wikipedia.org/wiki/Bilinear_interpolation#Weighted_mean
-                float x = i * cellWidth;
-                float y = j * cellHeight;
+        void blendRows(float const *values, size_t const y);   // Blends the input rows of output row y into m_blendedRow.
+        void interpolateRow(float *outputRow) const;            // Interpolates m_blendedRow at the output columns.
 
-                size_t x1 = static_cast<size_t>(x);
-                size_t y1 = static_cast<size_t>(y);
-                size_t x2 = x1 + 1U;
-                size_t y2 = y1 + 1U;
+    public:
+        // Recomputes the tables if the sizes differ from those of the last call.
+        void setSizes(size_t const sideSize, size_t const xMax, size_t const yMax);
 
-                float fx1 = static_cast<float>(x1);
-                float fx2 = static_cast<float>(x2);
-                float fy1 = static_cast<float>(y1);
-                float fy2 = static_cast<float>(y2);
+        // Resamples sideSize * sideSize values into xMax * yMax values, which must not overlap them.
+        void resample(float const *values, float *output);
 
-                float w11 = (fx2 - x) * (fy2 - y) / ((fx2 - fx1) * (fy2 - y));
-                float w12 = (fx2 - x) * (y - fy1) / ((fx2 - fx1) * (fy2 - y));
-                float w21 = (x - fx1) * (fy2 - y) / ((fx2 - fx1) * (fy2 - y));
-                float w22 = (x - fx1) * (y - fy1) / ((fx2 - fx1) * (fy2 - y));
+        // Resamples both components of a vector field with the same tables in one pass over the output rows. After each
+        // row it calls rowFunction(y, rowX, rowY) with the xMax samples of output row y of each component, so whatever
+        // is derived from them can be computed and stored while they are in cache, without full-size intermediates.
+        template <typename RowFunction>
+        void resampleVector(float const *valuesX, float const *valuesY, RowFunction &&rowFunction)
+        {
+            m_outputRows.resize(2U * m_xMax);
+            float *rowX = m_outputRows.data();
+            float *rowY = rowX + m_xMax;
 
-                interpolatedValues[j * xMax + i] = w11 * values[xMax * y1 + x1]
-                                                 + w12 * values[xMax * y2 + x1]
-                                                 + w21 * values[xMax * y1 + x2]
-                                                 + w22 * values[xMax * y2 + x2]; // Store in row-major format
+            for (size_t y = 0U; y < m_yMax; ++y)
+            {
+                blendRows(valuesX, y);
+                interpolateRow(rowX);
+                blendRows(valuesY, y);
+                interpolateRow(rowY);
+                rowFunction(y, static_cast<float const *>(rowX), static_cast<float const *>(rowY));
             }
         }
+    };
+
+    // Resamples with a SquareResampler per thread, which keeps its tables between calls with the same sizes.
+    void resampleSquare(float const *values, size_t const sideSize, size_t const xMax, size_t const yMax, float *output);
 
+    /* Input
+     * values: You may assume this is of the type std::vector<float>. This contains the values (e.g. densities) to be interpolated.
+     * sideSize: The input size of the square matrix "values". This is equal to m_DIM in the Simulation and Visualization classes.
+     * xMax, yMax: The desired dimensions of the output vector. xMax is the horizontal size (number of columns), yMax is the vertical size (number of rows).
+     *
+     * Output
+     * interpolatedValues: A 1D row-mayor container of std::vector<float> type containing the interpolated values.
+     */
+    template <typename inVector>
+    std::vector<float> interpolateSquareVector(inVector const &values, size_t const sideSize, size_t const xMax, size_t const yMax)
+    {
+        std::vector<float> interpolatedValues(xMax * yMax);
+        resampleSquare(values.data(), sideSize, xMax, yMax, interpolatedValues.data());
         return interpolatedValues;
     }
 };
@@ -1,194 +1,657 @@
 #include "lic.h"
 
+#include "parallel.h"
+
 #include <QDebug>
+#include <QtGlobal>
+#include <QVector2D>
 
 #include<vector>
 #include<numeric>
-#include <random>
 #include <algorithm>
+#include <array>
 #include <iterator>
 #include <iostream>
 
-Lic::Lic(unsigned int xDim, unsigned int yDim)
-    :
-      dim_x(xDim),
-      dim_y(yDim)
+namespace
 {
-    texture = std::vector<float>(dim_x * dim_y, 0.0F);
+    // SplitMix64 finalizer: a bijective mix whose output bits all depend on all input bits, so hashing consecutive
+    // counters gives independent-looking values. This makes the noise a pure function of (seed, pixel), which
+    // threads can generate in any order.
+    uint64_t splitMix64(uint64_t z)
+    {
+        z = (z ^ (z >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27U)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31U);
+    }
+
+    // Bilinear interpolation in a row-major dimX x dimY grid at (gx, gy), in grid units: value (i, j) lies at (i, j).
+    // Positions beyond the outermost grid points take the border values.
+    struct Bilinear
+    {
+        size_t i00;
+        size_t i10;
+        size_t i01;
+        size_t i11;
+        float tx;
+        float ty;
+
+        Bilinear(float const gx, float const gy, size_t const dimX, size_t const dimY)
+        {
+            float const fx = std::clamp(gx, 0.0F, static_cast<float>(dimX - 1U));
+            float const fy = std::clamp(gy, 0.0F, static_cast<float>(dimY - 1U));
+            // Converting through int is much cheaper than converting a float to size_t.
+            size_t const x0 = static_cast<unsigned int>(static_cast<int>(fx));
+            size_t const y0 = static_cast<unsigned int>(static_cast<int>(fy));
+            size_t const x1 = std::min(x0 + 1U, dimX - 1U);
+            size_t const y1 = std::min(y0 + 1U, dimY - 1U);
+            i00 = x0 + dimX * y0;
+            i10 = x1 + dimX * y0;
+            i01 = x0 + dimX * y1;
+            i11 = x1 + dimX * y1;
+            tx = fx - static_cast<float>(x0);
+            ty = fy - static_cast<float>(y0);
+        }
+
+        float operator()(float const *values) const
+        {
+            float const bottom = values[i00] + tx * (values[i10] - values[i00]);
+            float const top = values[i01] + tx * (values[i11] - values[i01]);
+            return bottom + ty * (top - bottom);
+        }
+    };
+
+    // A row-major fieldDimX x fieldDimY vector field that covers a dimX x dimY texture, with its first and last grid
+    // points on the edges of the texture. Streamlines are traced in the pixels of the texture.
+    struct VectorField
+    {
+        float const *x;
+        float const *y;
+        size_t fieldDimX;
+        size_t fieldDimY;
+        size_t dimX;
+        size_t dimY;
+        float scaleX;   // Field grid units per pixel.
+        float scaleY;
+        float aspect;   // Turns the field's y component into pixels of the same size as its x component.
+
+        VectorField(float const *vectorField_x, float const *vectorField_y,
+                    unsigned int const fieldDim_x, unsigned int const fieldDim_y, unsigned int const dim_x, unsigned int const dim_y)
+            :
+              x(vectorField_x),
+              y(vectorField_y),
+              fieldDimX(fieldDim_x),
+              fieldDimY(fieldDim_y),
+              dimX(dim_x),
+              dimY(dim_y),
+              scaleX(Lic::fieldScale(fieldDim_x, dim_x)),
+              scaleY(Lic::fieldScale(fieldDim_y, dim_y)),
+              aspect(scaleX / scaleY)
+        {}
+
+        // The field at p (in pixels), bilinearly interpolated, normalized and multiplied by sign.
+        // Returns false where the field vanishes.
+        bool direction(QVector2D const &p, float const sign, QVector2D &direction) const
+        {
+            Bilinear const bilinear{p.x() * scaleX, p.y() * scaleY, fieldDimX, fieldDimY};
+            float const vx = bilinear(x);
+            float const vy = bilinear(y) * aspect;
+            float const length = std::sqrt(vx * vx + vy * vy);
+            if (!(length > 1e-12F)) // Also stops at NaNs.
+                return false;
+
+            direction = QVector2D{vx, vy} * (sign / length);
+            return true;
+        }
+
+        // The field at p (in pixels), bilinearly interpolated, as a velocity in pixels per time unit: the field is in
+        // domain widths per time unit, and the domain is fieldDim grid cells wide. Returns false at NaNs.
+        bool velocity(QVector2D const &p, QVector2D &velocity) const
+        {
+            Bilinear const bilinear{p.x() * scaleX, p.y() * scaleY, fieldDimX, fieldDimY};
+            float const vx = bilinear(x) * static_cast<float>(fieldDimX) / scaleX;
+            float const vy = bilinear(y) * static_cast<float>(fieldDimY) / scaleY;
+            if (!std::isfinite(vx) || !std::isfinite(vy))
+                return false;
+
+            velocity = QVector2D{vx, vy};
+            return true;
+        }
+
+        bool contains(QVector2D const &p) const
+        {
+            return p.x() >= 0.0F && p.y() >= 0.0F && p.x() < static_cast<float>(dimX) && p.y() < static_cast<float>(dimY);
+        }
+
+        // Row-major index of the pixel containing p, which must lie inside the field.
+        unsigned int pixel(QVector2D const &p) const
+        {
+            return static_cast<unsigned int>(static_cast<int>(p.x()) + static_cast<int>(dimX) * static_cast<int>(p.y()));
+        }
+    };
+
+    // Moves p one step of Lic::STEP_SIZE pixels along the streamline, forward for sign 1 and backward for sign -1.
+    // Returns false, leaving p unchanged, when the step runs into a point where the field vanishes.
+    template <Lic::IntegrationMethod method>
+    bool step(VectorField const &field, float const sign, QVector2D &p)
+    {
+        float const h = Lic::STEP_SIZE;
+
+        QVector2D k1;
+        QVector2D k2;
+        if (!field.direction(p, sign, k1) || !field.direction(p + 0.5F * h * k1, sign, k2))
+            return false;
+
+        if constexpr (method == Lic::IntegrationMethod::RungeKutta2)
+        {
+            p += h * k2;
+        }
+        else
+        {
+            QVector2D k3;
+            QVector2D k4;
+            if (!field.direction(p + 0.5F * h * k2, sign, k3) || !field.direction(p + h * k3, sign, k4))
+                return false;
 
-    boxFilterLUT_1 = std::vector<float>(); // Look-up-table filter
-    boxFilterLUT_2 = std::vector<float>(); // Look-up-table filter
-    texture = generateNoiseTexture(texture); // Generate original noise texture
+            p += (h / 6.0F) * (k1 + 2.0F * k2 + 2.0F * k3 + k4);
+        }
+
+        return true;
+    }
 
-    for (int i = 0; i < LUT_FILTER_SIZE; ++i)
+    // Moves p along the field as a velocity (see VectorField::velocity) over the time h, which is negative to move
+    // backward. Returns false, leaving p unchanged, when the step runs into a NaN.
+    template <Lic::IntegrationMethod method>
+    bool velocityStep(VectorField const &field, float const h, QVector2D &p)
     {
-        boxFilterLUT_1.push_back(i);
-        boxFilterLUT_2.push_back(i);
+        QVector2D k1;
+        QVector2D k2;
+        if (!field.velocity(p, k1) || !field.velocity(p + 0.5F * h * k1, k2))
+            return false;
+
+        if constexpr (method == Lic::IntegrationMethod::RungeKutta2)
+        {
+            p += h * k2;
+        }
+        else
+        {
+            QVector2D k3;
+            QVector2D k4;
+            if (!field.velocity(p + 0.5F * h * k2, k3) || !field.velocity(p + h * k3, k4))
+                return false;
+
+            p += (h / 6.0F) * (k1 + 2.0F * k2 + 2.0F * k3 + k4);
+        }
+
+        return true;
     }
+}
+
+Lic::Lic(unsigned int xDim, unsigned int yDim)
+    :
+      dim_x(xDim),
+      dim_y(yDim)
+{
+    generateNoiseTexture(); // Generate original noise texture
 
     qDebug() << "LIC Constructed";
 }
 
-///		normalize the vector field     ///
-void Lic::normalizeVectors(std::vector<float>* vectorField_x, std::vector<float>* vectorField_y)
+///		make white noise as the LIC input texture     ///
+void Lic::generateNoiseTexture()
 {
-    size_t length = vectorField_x->size();
+    texture.resize(dim_x * dim_y);
+    ++noise_version;
 
-    for (size_t i = 0; i < length; ++i)
+    // Value n of seed s is the top byte of SplitMix64(s * 2^32 + n), so it does not depend on the order or
+    // number of threads, and the same seed always gives the same texture.
+    uint64_t const key = static_cast<uint64_t>(noise_seed) << 32U;
+    parallel::forRowBands(dim_y, dim_x, [&](size_t const rowBegin, size_t const rowEnd)
     {
-        // Scale each vector to length 1
-        float factor = sqrt(pow((*vectorField_x)[i], 2.0F) + pow((*vectorField_y)[i], 2.0F));
-        (*vectorField_x)[i] /= factor;
-        (*vectorField_y)[i] /= factor;
-    }
-//    float totals_x = std::inner_product( vectorField_x->begin(), vectorField_x->end(), vectorField_x->begin(), 0 );
-//    float totals_y = std::inner_product( vectorField_y->begin(), vectorField_y->end(), vectorField_y->begin(), 0 );
-//    std::for_each(vectorField_x->begin(), vectorField_x->end(), [totals_x](float &c){ c /= totals_x; });
-//    std::for_each(vectorField_y->begin(), vectorField_y->end(), [totals_y](float &c){ c /= totals_y; });
+        for (size_t idx = dim_x * rowBegin; idx < dim_x * rowEnd; ++idx)
+            texture[idx] = static_cast<float>(splitMix64(key + idx) >> 56U);
+    });
 }
 
+size_t Lic::getKernelSteps() const
+{
+    return std::min(MAX_STEPS, static_cast<size_t>(std::lround(kernel_length / STEP_SIZE)));
+}
 
-///		make white noise as the LIC input texture     ///
-std::vector<float> Lic::generateNoiseTexture(std::vector<float> texture)
+void Lic::mapFlowToTexture(float const *vectorField_x, float const *vectorField_y,
+                           unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out)
 {
-    // Seed random number generator
-    srand(time(NULL));
+    texture_out.resize(dim_x * dim_y);
 
-    // Generate random values: black or white
-    generate(begin(texture), end(texture), []() { return static_cast<float>(rand() % 256); });
-    return texture;
+    switch (algorithm)
+    {
+        case Algorithm::Standard:
+            if (integration_method == IntegrationMethod::RungeKutta2)
+                convolve<IntegrationMethod::RungeKutta2>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+            else
+                convolve<IntegrationMethod::RungeKutta4>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+        break;
+
+        case Algorithm::Fast:
+            if (integration_method == IntegrationMethod::RungeKutta2)
+                convolveFast<IntegrationMethod::RungeKutta2>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+            else
+                convolveFast<IntegrationMethod::RungeKutta4>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+        break;
+
+        case Algorithm::Advection:
+            if (integration_method == IntegrationMethod::RungeKutta2)
+                advect<IntegrationMethod::RungeKutta2>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+            else
+                advect<IntegrationMethod::RungeKutta4>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+        break;
+
+        case Algorithm::Oriented:
+            if (integration_method == IntegrationMethod::RungeKutta2)
+                convolveOriented<IntegrationMethod::RungeKutta2>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+            else
+                convolveOriented<IntegrationMethod::RungeKutta4>(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+        break;
+    }
+
+    if (contrast_enhancement != ContrastEnhancement::None)
+        enhanceContrast(texture_out);
 }
 
-std::vector<uint8_t> Lic::mapFlowToTexture(std::vector<float> vectorField_x, std::vector<float> vectorField_y, std::vector<float> texture_in)
+// Every pixel traces the streamline through its center up to kernel_length pixels forward and backward, collects the
+// noise of the pixels it passes in a fixed-size buffer on the stack, and gets the box-filtered average of those.
+// Streamlines end at the border and where the field vanishes. The field is normalized where it is sampled, which
+// handles zero vectors and gives unit speed between the grid points too. The output is row-major, like the field.
+// This is the reference for the GPU version in shaders/lic_gpu.frag, which does the same arithmetic per texel.
+template <Lic::IntegrationMethod method>
+void Lic::convolve(float const *vectorField_x, float const *vectorField_y,
+                   unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out) const
 {
-    std::vector<uint8_t> newTexture(dim_x*dim_y);
-    size_t L = 4; // Fixed length to determine streamline
+    VectorField const field{vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, dim_x, dim_y};
+    size_t const numberOfSteps = getKernelSteps();
 
-    for (size_t i = 0; i < dim_x; ++i)
+    parallel::forRowBands(dim_y, dim_x * 2U * numberOfSteps, [&](size_t const rowBegin, size_t const rowEnd)
     {
-        for (size_t j = 0; j < dim_y; ++j)
+        // Backward samples are stored before the center sample at MAX_STEPS, forward samples after it.
+        std::array<float, 2U * MAX_STEPS + 1U> samples;
+
+        for (size_t y = rowBegin; y < rowEnd; ++y)
         {
-            // Find the streamline
-            std::vector<std::vector<size_t>> streamline; // (L+1) x 2 matrix
-            streamline.resize(L+1);
+            for (size_t x = 0U; x < dim_x; ++x)
+            {
+                QVector2D const center{static_cast<float>(x) + 0.5F, static_cast<float>(y) + 0.5F};
+                size_t begin = MAX_STEPS;
+                size_t end = MAX_STEPS + 1U;
+                samples[MAX_STEPS] = texture[x + dim_x * y];
+
+                // Both halves are traced in the same loop, so the processor can overlap their independent steps.
+                QVector2D forward = center;
+                QVector2D backward = center;
+                bool forwardAlive = true;
+                bool backwardAlive = true;
+                for (size_t stepIdx = 0U; stepIdx < numberOfSteps && (forwardAlive || backwardAlive); ++stepIdx)
+                {
+                    forwardAlive = forwardAlive && step<method>(field, 1.0F, forward) && field.contains(forward);
+                    if (forwardAlive)
+                        samples[end++] = texture[field.pixel(forward)];
+
+                    backwardAlive = backwardAlive && step<method>(field, -1.0F, backward) && field.contains(backward);
+                    if (backwardAlive)
+                        samples[--begin] = texture[field.pixel(backward)];
+                }
 
-            streamline[0] = std::vector<size_t>{i, j}; // current pixel
+                float const sum = std::accumulate(samples.cbegin() + begin, samples.cbegin() + end, 0.0F);
+                texture_out[x + dim_x * y] = static_cast<uint8_t>(sum / static_cast<float>(end - begin));
+            }
+        }
+    });
+}
 
-            size_t x = i;
-            size_t y = j;
-            for (size_t k = 0; k < L; ++k) // Forward
+/* FastLIC (Stalling and Hege, 1995). Neighboring pixels on one streamline convolve almost the same noise, so instead of
+ * tracing a short streamline per pixel, a streamline FAST_LIC_EXTENSION kernel lengths longer on each side is traced
+ * from every pixel that no earlier streamline has passed yet. A running box sum then slides along the whole streamline,
+ * adding a sample and dropping one per step, and every pixel the streamline passes accumulates the convolution value
+ * at that point. Each pixel ends up with the average of its hits, and since most pixels are covered by the
+ * streamlines of others, the cost per pixel no longer grows with the kernel length.
+ *
+ * Streamlines cross row bands, so every band of seed rows accumulates into buffers of its own, which are summed
+ * afterwards. A band only skips the seeds its own streamlines have hit, so the output depends on the bands. There are
+ * always FAST_LIC_SEED_BANDS of them, spread over the threads there are, which gives the same output on every machine.
+ */
+template <Lic::IntegrationMethod method>
+void Lic::convolveFast(float const *vectorField_x, float const *vectorField_y,
+                       unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out)
+{
+    VectorField const field{vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, dim_x, dim_y};
+    size_t const kernelSteps = getKernelSteps();
+    size_t const maxSteps = (1U + FAST_LIC_EXTENSION) * kernelSteps;
+    size_t const numberOfPixels = dim_x * dim_y;
+
+    size_t const numberOfBands = std::min<size_t>(FAST_LIC_SEED_BANDS, dim_y);
+    fast_lic_buffers.resize(numberOfBands);
+
+    parallel::forBands(numberOfBands, [&](size_t const bandIdx)
+    {
+        FastLicBuffers &buffers = fast_lic_buffers[bandIdx];
+        buffers.accumulated.assign(numberOfPixels, 0.0F);
+        buffers.hits.assign(numberOfPixels, 0U);
+
+        // Like the samples in convolve(), but with room for the extended streamline.
+        buffers.streamline_noise.resize(2U * maxSteps + 1U);
+        buffers.streamline_pixels.resize(2U * maxSteps + 1U);
+        float *noise = buffers.streamline_noise.data();
+        unsigned int *pixels = buffers.streamline_pixels.data();
+
+        size_t const rowBegin = parallel::bandBegin(dim_y, numberOfBands, bandIdx);
+        size_t const rowEnd = parallel::bandBegin(dim_y, numberOfBands, bandIdx + 1U);
+        for (size_t y = rowBegin; y < rowEnd; ++y)
+        {
+            for (size_t x = 0U; x < dim_x; ++x)
             {
-                float vecX = vectorField_x[y * dim_x + x];
-                float vecY = vectorField_y[y * dim_x + x];
+                if (buffers.hits[x + dim_x * y] != 0U)
+                    continue;
 
-                // Divide the 'circle' around this pixel into eight segments, each one representing the angle to one of the neighbouring pixels.
-                // We can see this circle as the unit circle.
+                size_t begin = maxSteps;
+                size_t end = maxSteps + 1U;
+                noise[maxSteps] = texture[x + dim_x * y];
+                pixels[maxSteps] = static_cast<unsigned int>(x + dim_x * y);
 
-                // The vector points to the neighbour on the right when the angle of the vector from the x-axis is smaller than pi/8, i.e. when x > sqrt(3)/2
-                if (vecX >= sqrt(3)/2)
+                QVector2D const center{static_cast<float>(x) + 0.5F, static_cast<float>(y) + 0.5F};
+                QVector2D p = center;
+                while (end - (maxSteps + 1U) < maxSteps && step<method>(field, 1.0F, p) && field.contains(p))
                 {
-                    x = x+1;
+                    pixels[end] = field.pixel(p);
+                    noise[end] = texture[pixels[end]];
+                    ++end;
                 }
-                // The vector points to the upper right or lower right neighbour when the angle is in between +/- pi/8 and +/- 3/8*pi.
-                else if (vecX >= 1/2)
+
+                p = center;
+                while (maxSteps - begin < maxSteps && step<method>(field, -1.0F, p) && field.contains(p))
                 {
-                    if (vecY > 0) // upper right
-                    {
-                        x = x+1;
-                        y = y+1;
-                    }
-                    else // lower right
-                    {
-                        x = x+1;
-                        y = y-1;
-                    }
+                    --begin;
+                    pixels[begin] = field.pixel(p);
+                    noise[begin] = texture[pixels[begin]];
                 }
-                // The vector points to the upper or lower neighbour when the angle is in between +/- 3/8*pi and +/- 5/8*pi.
-                else if (vecX >= -1/2)
+
+                // The window of sample idx is [idx - kernelSteps, idx + kernelSteps], cut off at the ends of the streamline.
+                float sum = 0.0F;
+                size_t windowBegin = begin;
+                size_t windowEnd = begin;
+                for (size_t idx = begin; idx < end; ++idx)
                 {
-                    if (vecY > 0) // upper
-                    {
-                        y = y+1;
-                    }
-                    else // lower
-                    {
-                        y = y-1;
-                    }
+                    for (; windowEnd < std::min(end, idx + kernelSteps + 1U); ++windowEnd)
+                        sum += noise[windowEnd];
+                    for (; windowBegin + kernelSteps < idx; ++windowBegin)
+                        sum -= noise[windowBegin];
+
+                    buffers.accumulated[pixels[idx]] += sum / static_cast<float>(windowEnd - windowBegin);
+                    ++buffers.hits[pixels[idx]];
                 }
-                // The vector points to the upper or lower left neighbour when the angle is in between +/- 5/8 and +/- 7/8*pi.
-                else if (vecX >= -sqrt(3)/2)
+            }
+        }
+    });
+
+    // Every pixel has been hit at least once, by the streamline seeded in it if not by another.
+    parallel::forRowBands(dim_y, dim_x * numberOfBands, [&](size_t const rowBegin, size_t const rowEnd)
+    {
+        for (size_t idx = dim_x * rowBegin; idx < dim_x * rowEnd; ++idx)
+        {
+            float accumulated = 0.0F;
+            unsigned int hits = 0U;
+            for (FastLicBuffers const &buffers : fast_lic_buffers)
+            {
+                accumulated += buffers.accumulated[idx];
+                hits += buffers.hits[idx];
+            }
+            texture_out[idx] = static_cast<uint8_t>(accumulated / static_cast<float>(hits));
+        }
+    });
+}
+
+/* Oriented LIC (Wegenkittl, Groeller and Purgathofer, 1997). The noise is sparse: a pixel holds a white droplet where
+ * its noise value lies in the lowest OLIC_DROPLETS_PER_KERNEL / kernel_length of the range, and is black elsewhere.
+ * Every pixel traces its streamline backward only and weighs the droplets it passes with a ramp that grows with the
+ * distance. A droplet then leaves a trace downstream that gets brighter up to a sharp end, which shows the direction of
+ * the flow where the symmetric kernel of standard LIC only shows its orientation. With half a streamline per pixel, it
+ * is also cheaper.
+ */
+template <Lic::IntegrationMethod method>
+void Lic::convolveOriented(float const *vectorField_x, float const *vectorField_y,
+                           unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out) const
+{
+    VectorField const field{vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, dim_x, dim_y};
+    size_t const numberOfSteps = getKernelSteps();
+    float const dropletDensity = std::min(1.0F, OLIC_DROPLETS_PER_KERNEL / (STEP_SIZE * static_cast<float>(numberOfSteps)));
+    float const dropletThreshold = 256.0F * dropletDensity;
+
+    // Sample n weighs n / numberOfSteps, and a droplet spans about 1 / STEP_SIZE samples, so a droplet at the end of the
+    // kernel gives white.
+    float const scale = 255.0F * STEP_SIZE / static_cast<float>(numberOfSteps);
+
+    parallel::forRowBands(dim_y, dim_x * numberOfSteps, [&](size_t const rowBegin, size_t const rowEnd)
+    {
+        for (size_t y = rowBegin; y < rowEnd; ++y)
+        {
+            for (size_t x = 0U; x < dim_x; ++x)
+            {
+                QVector2D p{static_cast<float>(x) + 0.5F, static_cast<float>(y) + 0.5F};
+                float sum = 0.0F;
+                for (size_t stepIdx = 1U; stepIdx <= numberOfSteps && step<method>(field, -1.0F, p) && field.contains(p); ++stepIdx)
                 {
-                    if (vecY > 0) // upper left
-                    {
-                        x = x-1;
-                        y = y+1;
-                    }
-                    else // lower left
-                    {
-                        x = x-1;
-                        y = y-1;
-                    }
+                    if (texture[field.pixel(p)] < dropletThreshold)
+                        sum += static_cast<float>(stepIdx);
                 }
-                else // -1 > x > -sqrt(3)/2: the vector points to the left neighbour.
+
+                texture_out[x + dim_x * y] = static_cast<uint8_t>(std::min(255.0F, sum * scale));
+            }
+        }
+    });
+}
+
+// Builds one histogram of the output and maps it through a lookup table made from that histogram. Runs of equal gray
+// values are common in LIC output, so every band counts its pixels into HISTOGRAM_LANES partial histograms in turn:
+// increments of the same bin then go to different counters and do not wait on each other.
+void Lic::enhanceContrast(std::vector<uint8_t> &texture_out)
+{
+    size_t const numberOfPixels = texture_out.size();
+    size_t const numberOfBands = parallel::numberOfRowBands(dim_y, dim_x);
+    histograms.assign(HISTOGRAM_LANES * numberOfBands, Histogram{});
+
+    parallel::forBands(numberOfBands, [&](size_t const bandIdx)
+    {
+        Histogram *lanes = &histograms[HISTOGRAM_LANES * bandIdx];
+        uint8_t const *pixels = texture_out.data();
+        size_t const end = dim_x * parallel::bandBegin(dim_y, numberOfBands, bandIdx + 1U);
+        size_t idx = dim_x * parallel::bandBegin(dim_y, numberOfBands, bandIdx);
+        for (; idx + HISTOGRAM_LANES <= end; idx += HISTOGRAM_LANES)
+        {
+            for (size_t lane = 0U; lane < HISTOGRAM_LANES; ++lane)
+                ++lanes[lane][pixels[idx + lane]];
+        }
+        for (; idx < end; ++idx)
+            ++lanes[0][pixels[idx]];
+    });
+
+    Histogram histogram{};
+    for (Histogram const &lane : histograms)
+    {
+        for (size_t value = 0U; value < histogram.size(); ++value)
+            histogram[value] += lane[value];
+    }
+
+    std::array<uint8_t, 256U> lookup;
+    std::iota(lookup.begin(), lookup.end(), uint8_t{0U}); // Constant images stay as they are.
+
+    switch (contrast_enhancement)
+    {
+        case ContrastEnhancement::None:
+        break;
+
+        case ContrastEnhancement::Stretch:
+        {
+            // The lowest and highest values with more than the clipped number of pixels at or beyond them.
+            size_t const clipped = static_cast<size_t>(CONTRAST_STRETCH_CLIP * static_cast<float>(numberOfPixels));
+            size_t low = 0U;
+            size_t countAtOrBelow = histogram[low];
+            while (low < 255U && countAtOrBelow <= clipped)
+                countAtOrBelow += histogram[++low];
+
+            size_t high = 255U;
+            size_t countAtOrAbove = histogram[high];
+            while (high > 0U && countAtOrAbove <= clipped)
+                countAtOrAbove += histogram[--high];
+
+            if (high > low)
+            {
+                float const scale = 255.0F / static_cast<float>(high - low);
+                for (size_t value = 0U; value < lookup.size(); ++value)
                 {
-                    x = x-1;
+                    float const stretched = (static_cast<float>(value) - static_cast<float>(low)) * scale;
+                    lookup[value] = static_cast<uint8_t>(std::clamp(stretched + 0.5F, 0.0F, 255.0F));
                 }
-
-                streamline[1 + k] = std::vector<size_t>{x, y};
             }
+        }
+        break;
 
-            // Apply kernel: simple box blur, i.e. each pixel has a value equal to the average value of its neighbours.
-            float sum = 0.0F;
-            size_t count = 0;
-            for (std::vector<size_t> coordinates : streamline)
+        case ContrastEnhancement::Equalize:
+        {
+            // The lowest value present maps to 0, the highest to 255.
+            size_t const lowest = static_cast<size_t>(std::find_if(histogram.cbegin(), histogram.cend(),
+                                                                   [](unsigned int const count) { return count != 0U; })
+                                                      - histogram.cbegin());
+            size_t const lowestCount = histogram[lowest];
+            if (numberOfPixels > lowestCount)
             {
-                if (0 <= coordinates[0] && coordinates[0] < dim_x && 0 <= coordinates[1] && coordinates[1] < dim_y)
+                float const scale = 255.0F / static_cast<float>(numberOfPixels - lowestCount);
+                size_t cumulative = 0U;
+                for (size_t value = 0U; value < lookup.size(); ++value)
                 {
-                    sum += texture_in[coordinates[1] + coordinates[0] * dim_y]; // column-major
-                    count++;
+                    cumulative += histogram[value];
+                    float const rank = static_cast<float>(cumulative > lowestCount ? cumulative - lowestCount : 0U);
+                    lookup[value] = static_cast<uint8_t>(rank * scale + 0.5F);
                 }
             }
-            newTexture[j + i * dim_y] = static_cast<uint8_t>(sum / static_cast<float>(count)); // column-major, which is needed by GLSL.
         }
+        break;
     }
 
-    return newTexture;
+    // Byte stores may alias anything, so through the vector every iteration would reload its data pointer and dim_x.
+    uint8_t *pixels = texture_out.data();
+    parallel::forRowBands(dim_y, dim_x, [&](size_t const rowBegin, size_t const rowEnd)
+    {
+        uint8_t *const end = pixels + dim_x * rowEnd;
+        for (uint8_t *pixel = pixels + dim_x * rowBegin; pixel != end; ++pixel)
+            *pixel = lookup[*pixel];
+    });
 }
 
-std::vector<uint8_t> Lic::updateTexture(std::vector<float> vectorField_x, std::vector<float> vectorField_y, std::vector<float> texture_in)
+/* Texture advection for unsteady flow, as in Image Based Flow Visualization (van Wijk, 2002). Instead of convolving
+ * static noise from scratch, every frame moves the previous output along the current field and blends a little noise
+ * into it. Each pixel traces the path through its center backward, in ADVECTION_STEPS steps, and takes the bilinearly
+ * interpolated previous output there, so the texture flows with the field. With AdvectionSpeed::Velocity the path
+ * covers advection_time_step of the flow, so the texture moves as fast as the flow; with AdvectionSpeed::Constant it
+ * is ADVECTION_STEPS * STEP_SIZE pixels long wherever the field does not vanish.
+ *
+ * The blend weight per frame decays exponentially with a mean of kernel_length / (ADVECTION_STEPS * STEP_SIZE) frames,
+ * which gives streaks of about the LIC kernel length where the texture moves ADVECTION_STEPS * STEP_SIZE pixels per
+ * frame. At velocity speed, faster flow draws longer streaks and slower flow shorter ones, as in IBFV. As the field
+ * changes, the streaks follow it smoothly.
+ *
+ * Injecting new white noise every frame would flicker, so every pixel follows a square wave of ADVECTION_NOISE_PERIOD
+ * frames instead, with the noise texture as its phase. The noise then changes a little every frame while its values
+ * stay white noise in space.
+ */
+template <Lic::IntegrationMethod method>
+void Lic::advect(float const *vectorField_x, float const *vectorField_y,
+                 unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out)
 {
-    //you shouldn't need to edit this!
+    VectorField const field{vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, dim_x, dim_y};
+    size_t const numberOfPixels = dim_x * dim_y;
+
+    float const time = static_cast<float>(advection_frame % ADVECTION_NOISE_PERIOD) / static_cast<float>(ADVECTION_NOISE_PERIOD);
+    auto const injectedNoise = [&](size_t const idx)
+    {
+        float const phase = time + texture[idx] / 256.0F;
+        return phase - std::floor(phase) < 0.5F ? 255.0F : 0.0F;
+    };
+
+    // Start from the noise itself after a resize, so the streaks build up over the first frames.
+    if (advected_texture.size() != numberOfPixels)
+    {
+        advected_texture.resize(numberOfPixels);
+        for (size_t idx = 0U; idx < numberOfPixels; ++idx)
+            advected_texture[idx] = injectedNoise(idx);
+    }
+    advected_texture_next.resize(numberOfPixels);
 
-    normalizeVectors(&vectorField_x, &vectorField_y);
-    std::vector<uint8_t> const texture_out = mapFlowToTexture(vectorField_x, vectorField_y, texture_in);
+    float const noiseWeight = 1.0F - std::exp(-static_cast<float>(ADVECTION_STEPS) * STEP_SIZE / kernel_length);
+    bool const velocitySpeed = advection_speed == AdvectionSpeed::Velocity;
+    float const timeStep = advection_time_step / static_cast<float>(ADVECTION_STEPS);
 
-    return texture_out;
+    parallel::forRowBands(dim_y, dim_x * ADVECTION_STEPS, [&](size_t const rowBegin, size_t const rowEnd)
+    {
+        for (size_t y = rowBegin; y < rowEnd; ++y)
+        {
+            for (size_t x = 0U; x < dim_x; ++x)
+            {
+                // Where the field vanishes, the texture stays in place.
+                QVector2D p{static_cast<float>(x) + 0.5F, static_cast<float>(y) + 0.5F};
+                size_t stepIdx = 0U;
+                if (velocitySpeed)
+                {
+                    while (stepIdx < ADVECTION_STEPS && velocityStep<method>(field, -timeStep, p))
+                        ++stepIdx;
+                }
+                else
+                {
+                    while (stepIdx < ADVECTION_STEPS && step<method>(field, -1.0F, p))
+                        ++stepIdx;
+                }
+
+                size_t const idx = x + dim_x * y;
+                // The texture values lie at the pixel centers.
+                float const previous = Bilinear{p.x() - 0.5F, p.y() - 0.5F, dim_x, dim_y}(advected_texture.data());
+                float const value = previous + noiseWeight * (injectedNoise(idx) - previous);
+                advected_texture_next[idx] = value;
+                texture_out[idx] = static_cast<uint8_t>(value);
+            }
+        }
+    });
+
+    advected_texture.swap(advected_texture_next);
+    ++advection_frame;
 }
 
-std::vector<uint8_t> Lic::updateTexture(std::vector<float> vectorField_x, std::vector<float> vectorField_y, std::vector<float> texture_in, unsigned int newDim_x, unsigned int newDim_y)
+void Lic::updateTexture(float const *vectorField_x, float const *vectorField_y,
+                        unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out)
 {
-    //you shouldn't need to edit this!
+    Q_ASSERT(fieldDim_x >= 2U && fieldDim_y >= 2U);
+    Q_ASSERT(vectorField_x != nullptr && vectorField_y != nullptr);
+
+    mapFlowToTexture(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+}
 
-    int dims = newDim_x * newDim_y;
-    if (dims != vectorField_x.size() || dims != vectorField_y.size())
+bool Lic::updateTexture(float const *vectorField_x, float const *vectorField_y,
+                        unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out,
+                        unsigned int newDim_x, unsigned int newDim_y)
+{
+    if (fieldDim_x < 2U || fieldDim_y < 2U || vectorField_x == nullptr || vectorField_y == nullptr)
     {
-        qDebug() << "Dimension mismatch between LIC dimensions and incoming vector fields, aborting";
-        std::vector<uint8_t> failed_texture;
-        return failed_texture;
+        qDebug() << "The vector field is missing or smaller than 2 x 2, aborting";
+        return false;
     }
 
-    setXDim(newDim_x);
-    setYDim(newDim_y);
+    if (newDim_x != dim_x || newDim_y != dim_y)
+        resetTexture(newDim_x, newDim_y);
 
-    normalizeVectors(&vectorField_x, &vectorField_y);
-    std::vector<uint8_t> const texture_out = mapFlowToTexture(vectorField_x, vectorField_y, texture_in);
-
-    return texture_out;
+    mapFlowToTexture(vectorField_x, vectorField_y, fieldDim_x, fieldDim_y, texture_out);
+    return true;
 }
 
 void Lic::resetTexture()
 {
-    texture = generateNoiseTexture(texture);
+    ++noise_seed;
+    generateNoiseTexture();
 }
 
 void Lic::resetTexture(unsigned int newXDim, unsigned int newYDim)
@@ -196,7 +659,5 @@ void Lic::resetTexture(unsigned int newXDim, unsigned int newYDim)
     setXDim(newXDim);
     setYDim(newYDim);
 
-    texture = std::vector<float>(dim_x * dim_y, 0.0F);
-
-    texture = generateNoiseTexture(texture);
+    resetTexture();
 }
@@ -1,45 +1,178 @@
 #ifndef LIC_H
 #define LIC_H
 
+#include <array>
 #include <cmath>
 #include <cstdint>
 #include <vector>
-#include <time.h>
 
 class Lic
 {
-    int const LUT_FILTER_SIZE = 2048;
     float const LOWPASS_FILTER_LENGTH = 10.00000F;
 
 public:
+    // How streamlines are integrated. Both take steps of STEP_SIZE pixels along the normalized, bilinearly interpolated field.
+    enum class IntegrationMethod
+    {
+        RungeKutta2,
+        RungeKutta4
+    };
+
+    enum class Algorithm
+    {
+        Standard,   // One streamline per pixel. Not interactive at 512 x 512 on the CPU: about 0.7 s (RK2) to 1.5 s (RK4)
+                    // per frame on one core. Meant as the reference; use Fast or the GPU for animation.
+        Fast,       // FastLIC: long streamlines shared by all pixels they pass.
+        Advection,  // Unsteady: the previous output is advected along the field and blended with fresh noise.
+        Oriented    // OLIC: sparse droplets smeared with an asymmetric kernel, so their traces show the flow direction.
+    };
+
+    // How far texture advection moves the texture per frame.
+    enum class AdvectionSpeed
+    {
+        Velocity,   // As far as the flow moves in the advection time step, so slow regions move slowly.
+        Constant    // ADVECTION_STEPS * STEP_SIZE pixels along the field wherever it does not vanish, whatever its magnitude.
+    };
+
+    // Post-pass on the output, computed from one histogram of it.
+    enum class ContrastEnhancement
+    {
+        None,
+        Stretch,    // Linearly maps the gray values between the outer CONTRAST_STRETCH_CLIP fractions of pixels to 0 to 255.
+        Equalize    // Histogram equalization: maps every gray value to its rank, so all get about as many pixels.
+    };
+
+    // Streamlines are traced in steps of this many pixels.
+    static constexpr float STEP_SIZE = 0.5F;
+
+    // Upper bound on the number of steps in each direction, which sizes the per-pixel sample buffer.
+    static constexpr size_t MAX_STEPS = 128U;
+
+    // FastLIC traces streamlines this many kernel lengths past the kernel in each direction.
+    static constexpr size_t FAST_LIC_EXTENSION = 4U;
+
+    // FastLIC divides the seed rows into this many bands, whatever the number of threads, as its output depends on it.
+    static constexpr size_t FAST_LIC_SEED_BANDS = 4U;
+
+    // Texture advection moves the texture in this many steps along the field per frame: of STEP_SIZE pixels each with
+    // AdvectionSpeed::Constant, or of this fraction of the advection time step with AdvectionSpeed::Velocity.
+    static constexpr size_t ADVECTION_STEPS = 4U;
+
+    // Texture advection injects noise in which every pixel switches between black and white once per this many frames.
+    static constexpr unsigned int ADVECTION_NOISE_PERIOD = 32U;
+
+    // Droplets a streamline passes within the kernel length in OLIC, on average: one pixel in 32 holds a droplet at the
+    // default length. The density falls with the kernel length, so the traces cover the same share of the image at any
+    // length instead of piling up into white.
+    static constexpr float OLIC_DROPLETS_PER_KERNEL = 10.0F / 32.0F;
+
+    // Fraction of the pixels that ContrastEnhancement::Stretch saturates at each end.
+    static constexpr float CONTRAST_STRETCH_CLIP = 0.01F;
+
     Lic(unsigned int xDim, unsigned int yDim);
 
     void setXDim(unsigned int newXDim) { dim_x = newXDim; }
     void setYDim(unsigned int newYDim) { dim_y = newYDim; }
+    void setKernelLength(float newKernelLength) { kernel_length = newKernelLength; } // In pixels, in each direction; at most MAX_STEPS * STEP_SIZE.
+    void setIntegrationMethod(IntegrationMethod newIntegrationMethod) { integration_method = newIntegrationMethod; }
+    void setAlgorithm(Algorithm newAlgorithm) { algorithm = newAlgorithm; }
+    void setContrastEnhancement(ContrastEnhancement newContrastEnhancement) { contrast_enhancement = newContrastEnhancement; }
+    void setAdvectionSpeed(AdvectionSpeed newAdvectionSpeed) { advection_speed = newAdvectionSpeed; }
+    // The time one frame of texture advection covers. The field is then read as a velocity in domain widths per time
+    // unit, with the domain fieldDim grid cells wide, as the simulation moves its grid points.
+    void setAdvectionTimeStep(float newAdvectionTimeStep) { advection_time_step = newAdvectionTimeStep; }
+    void setNoiseSeed(uint32_t newNoiseSeed) { noise_seed = newNoiseSeed; generateNoiseTexture(); } // The same seed always gives the same noise.
 
     [[nodiscard]] unsigned int getXDim() const { return dim_x; }
     [[nodiscard]] unsigned int getYDim() const { return dim_y; }
-    [[nodiscard]] std::vector<float> getTexture() const { return texture; }
+    [[nodiscard]] float getKernelLength() const { return kernel_length; }
+    [[nodiscard]] size_t getKernelSteps() const; // The kernel length in steps of STEP_SIZE, at most MAX_STEPS.
+    [[nodiscard]] IntegrationMethod getIntegrationMethod() const { return integration_method; }
+    [[nodiscard]] Algorithm getAlgorithm() const { return algorithm; }
+    [[nodiscard]] ContrastEnhancement getContrastEnhancement() const { return contrast_enhancement; }
+    [[nodiscard]] AdvectionSpeed getAdvectionSpeed() const { return advection_speed; }
+    [[nodiscard]] float getAdvectionTimeStep() const { return advection_time_step; }
+    [[nodiscard]] std::vector<float> const &getTexture() const { return texture; } // The noise texture.
+    [[nodiscard]] unsigned int getNoiseVersion() const { return noise_version; } // Changes whenever the noise texture does.
 
-    std::vector<uint8_t> updateTexture(std::vector<float> vectorField_x, std::vector<float> vectorField_y, std::vector<float> texture_in); // Goes through the process of updating the noise texture, returns a vector<float> containing values that make up an updated texture
-    std::vector<uint8_t> updateTexture(std::vector<float> vectorField_x, std::vector<float> vectorField_y, std::vector<float> texture_in, unsigned int newDim_x, unsigned int newDim_y); //same as above, but also sets dim_x and dim_y to new values before doing so, and asserts that the incoming vector field is of a matching size.
-    void resetTexture(); // resets noise texture to pure random - use if you need to refresh the noise texture
+    // Convolves the noise texture along the row-major fieldDim_x x fieldDim_y vector field into texture_out, which is
+    // resized to dim_x * dim_y and can be reused between calls. The components are read in place, so they can point
+    // straight into the simulation's fields. The field is bilinearly interpolated wherever a
+    // streamline samples it, so it can be much coarser than the texture: its first and last grid points lie on the
+    // edges of the texture. The vectors need not be normalized; streamlines end at zero vectors.
+    void updateTexture(float const *vectorField_x, float const *vectorField_y,
+                       unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out);
+    // Same as above, but first sets dim_x and dim_y to the new values. Returns false, leaving texture_out as it is, if a component is missing or the field is smaller than 2 x 2.
+    bool updateTexture(float const *vectorField_x, float const *vectorField_y,
+                       unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out,
+                       unsigned int newDim_x, unsigned int newDim_y);
+    void resetTexture(); // moves on to the next noise seed - use if you need to refresh the noise texture
     void resetTexture(unsigned int newXDim, unsigned int newYDim);
 
+    // Field grid units per texture pixel along an edge of textureDim pixels that spans fieldDim grid points.
+    [[nodiscard]] static float fieldScale(unsigned int fieldDim, unsigned int textureDim)
+    {
+        return static_cast<float>(fieldDim - 1U) / static_cast<float>(textureDim);
+    }
+
 private:
     unsigned int dim_x, dim_y;
 
-    int testing_iterator = 0;
+    float kernel_length = LOWPASS_FILTER_LENGTH;
+    IntegrationMethod integration_method = IntegrationMethod::RungeKutta2;
+    Algorithm algorithm = Algorithm::Fast;
+    ContrastEnhancement contrast_enhancement = ContrastEnhancement::None;
+    AdvectionSpeed advection_speed = AdvectionSpeed::Velocity;
+    float advection_time_step = 1.0F;
 
+    uint32_t noise_seed = 0U;
+    unsigned int noise_version = 0U;
     std::vector<float> texture; // texture stored and updated locally
-    std::vector<float> boxFilterLUT_1;
-    std::vector<float> boxFilterLUT_2;
 
-    std::vector<float> generateNoiseTexture(std::vector<float> texture);
+    // FastLIC buffers of one of the FAST_LIC_SEED_BANDS row bands of seeds, kept between frames: the noise and pixel of every sample on the current
+    // streamline, and the summed convolution values and number of streamline samples per pixel.
+    struct FastLicBuffers
+    {
+        std::vector<float> streamline_noise;
+        std::vector<unsigned int> streamline_pixels;
+        std::vector<float> accumulated;
+        std::vector<unsigned int> hits;
+    };
+
+    std::vector<FastLicBuffers> fast_lic_buffers;
+
+    // Texture advection: the output of the previous frame, the one being computed, and the frame number.
+    std::vector<float> advected_texture;
+    std::vector<float> advected_texture_next;
+    unsigned int advection_frame = 0U;
+
+    // Contrast enhancement: HISTOGRAM_LANES partial histograms per row band of the output, kept between frames.
+    static constexpr size_t HISTOGRAM_LANES = 4U;
+    using Histogram = std::array<unsigned int, 256U>;
+    std::vector<Histogram> histograms;
+
+    void generateNoiseTexture(); // Fills texture with the white noise of noise_seed, values 0 to 255.
+
+    void mapFlowToTexture(float const *vectorField_x, float const *vectorField_y,
+                          unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out);
+
+    template <IntegrationMethod method>
+    void convolve(float const *vectorField_x, float const *vectorField_y,
+                  unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out) const;
+
+    template <IntegrationMethod method>
+    void convolveFast(float const *vectorField_x, float const *vectorField_y,
+                      unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out);
+
+    template <IntegrationMethod method>
+    void convolveOriented(float const *vectorField_x, float const *vectorField_y,
+                          unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out) const;
+
+    void enhanceContrast(std::vector<uint8_t> &texture_out);
 
-    //Functions to edit:
-    void normalizeVectors(std::vector<float>* vectorField_x, std::vector<float>* vectorField_y);
-    std::vector<uint8_t> mapFlowToTexture(std::vector<float> vectorField_x, std::vector<float> vectorField_y, std::vector<float> texture_in);
+    template <IntegrationMethod method>
+    void advect(float const *vectorField_x, float const *vectorField_y,
+                unsigned int fieldDim_x, unsigned int fieldDim_y, std::vector<uint8_t> &texture_out);
 };
 
 #endif // LIC_H
@@ -99,6 +99,23 @@ private slots:
     // LIC, draw on/off.
     void on_drawLicCheckBox_toggled(bool checked);
 
+    // LIC, compute on the GPU or the CPU.
+    void on_licGpuCheckBox_toggled(bool checked);
+
+    // LIC, texture resolution.
+    void on_licMatchWindowCheckBox_toggled(bool checked);
+
+    // LIC, algorithm.
+    void on_licAlgorithmComboBox_currentIndexChanged(int index);
+    void on_licConstantSpeedCheckBox_toggled(bool checked);
+
+    // LIC, contrast enhancement.
+    void on_licContrastComboBox_currentIndexChanged(int index);
+
+    // LIC, kernel length and streamline integration.
+    void on_licKernelLengthSpinBox_valueChanged(int value);
+    void on_licIntegrationMethodComboBox_currentIndexChanged(int index);
+
     // Setters
     void setScalarDataMin(float const min);
     void setScalarDataMax(float const max);
@@ -6,3 +6,93 @@ void MainWindow::on_drawLicCheckBox_toggled(bool checked)
     auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
     visualizationPtr->m_drawLIC = checked;
 }
+
+void MainWindow::on_licGpuCheckBox_toggled(bool checked)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_licOnGpu = checked;
+
+    // The shader only computes standard LIC without a contrast post-pass, so these settings do not apply to it.
+    ui->licAlgorithmComboBox->setEnabled(!checked);
+    ui->licConstantSpeedCheckBox->setEnabled(!checked);
+    ui->licContrastComboBox->setEnabled(!checked);
+}
+
+void MainWindow::on_licMatchWindowCheckBox_toggled(bool checked)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_licMatchWindow = checked;
+    visualizationPtr->updateLicResolution();
+}
+
+void MainWindow::on_licAlgorithmComboBox_currentIndexChanged(int index)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+
+    switch (index)
+    {
+        case 0:
+            visualizationPtr->m_licObject.setAlgorithm(Lic::Algorithm::Fast);
+        break;
+
+        case 1:
+            visualizationPtr->m_licObject.setAlgorithm(Lic::Algorithm::Standard);
+        break;
+
+        case 2:
+            visualizationPtr->m_licObject.setAlgorithm(Lic::Algorithm::Advection);
+        break;
+
+        case 3:
+            visualizationPtr->m_licObject.setAlgorithm(Lic::Algorithm::Oriented);
+        break;
+    }
+}
+
+void MainWindow::on_licConstantSpeedCheckBox_toggled(bool checked)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_licObject.setAdvectionSpeed(checked ? Lic::AdvectionSpeed::Constant : Lic::AdvectionSpeed::Velocity);
+}
+
+void MainWindow::on_licContrastComboBox_currentIndexChanged(int index)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+
+    switch (index)
+    {
+        case 0:
+            visualizationPtr->m_licObject.setContrastEnhancement(Lic::ContrastEnhancement::None);
+        break;
+
+        case 1:
+            visualizationPtr->m_licObject.setContrastEnhancement(Lic::ContrastEnhancement::Stretch);
+        break;
+
+        case 2:
+            visualizationPtr->m_licObject.setContrastEnhancement(Lic::ContrastEnhancement::Equalize);
+        break;
+    }
+}
+
+void MainWindow::on_licKernelLengthSpinBox_valueChanged(int value)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+    visualizationPtr->m_licObject.setKernelLength(static_cast<float>(value));
+}
+
+void MainWindow::on_licIntegrationMethodComboBox_currentIndexChanged(int index)
+{
+    auto const visualizationPtr = findChildSafe<Visualization*>("visualizationOpenGLWidget");
+
+    switch (index)
+    {
+        case 0:
+            visualizationPtr->m_licObject.setIntegrationMethod(Lic::IntegrationMethod::RungeKutta2);
+        break;
+
+        case 1:
+            visualizationPtr->m_licObject.setIntegrationMethod(Lic::IntegrationMethod::RungeKutta4);
+        break;
+    }
+}
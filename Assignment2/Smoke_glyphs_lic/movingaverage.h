@@ -4,7 +4,7 @@
 #include <QDebug>
 
 #include <cstddef>
-#include <queue>
+#include <vector>
 
 template <typename T>
 class MovingAverage
@@ -12,7 +12,10 @@ class MovingAverage
     size_t m_windowSize;
     T const m_initialValue;
 
-    std::queue<T> m_window;
+    // Contiguous ring buffer with the last m_windowSize values.
+    // m_head points at the oldest value, which is the next one to be overwritten.
+    std::vector<T> m_window;
+    size_t m_head = 0U;
     T m_average;
 
     void fillWindow();
@@ -44,33 +47,34 @@ void MovingAverage<T>::setWindowSize(size_t const windowSize)
 {
     Q_ASSERT(windowSize > 0);
     m_windowSize = windowSize;
-    m_average = m_initialValue;
-
-    // Empty the queue.
-    while (!m_window.empty())
-        m_window.pop();
 
     fillWindow();
 }
 
 // Fills the moving average window with initial values.
+// The buffer only reallocates when the window grows beyond its current capacity.
 template <typename T>
 void MovingAverage<T>::fillWindow()
 {
-    for (size_t n = 0; n < m_windowSize; ++n)
-        m_window.push(m_initialValue);
+    m_window.assign(m_windowSize, m_initialValue);
+    m_head = 0U;
+
+    // The running sum has to match the contents of the window.
+    m_average = m_initialValue;
+    for (size_t n = 1U; n < m_windowSize; ++n)
+        m_average += m_initialValue;
 }
 
 template <typename T>
 void MovingAverage<T>::update(T const &newValue)
 {
     // Compute new averages.
-    m_average -= m_window.front();
+    m_average -= m_window[m_head];
     m_average += newValue;
 
-    // Update queue.
-    m_window.pop();
-    m_window.push(newValue);
+    // Overwrite the oldest value and advance the head.
+    m_window[m_head] = newValue;
+    m_head = (m_head + 1U == m_windowSize) ? 0U : m_head + 1U;
 }
 
 template <typename T>
@@ -82,13 +86,9 @@ T MovingAverage<T>::average() const
 template <typename T>
 void MovingAverage<T>::printWindow() const
 {
-    qDebug() << "Printing queue:";
-    std::queue<T> tempQueue{m_window};
-    while (!tempQueue.empty())
-    {
-        qDebug() << tempQueue.front();
-        tempQueue.pop();
-    }
+    qDebug() << "Printing window (oldest first):";
+    for (size_t n = 0U; n < m_windowSize; ++n)
+        qDebug() << m_window[(m_head + n) % m_windowSize];
 }
 
 #endif // MOVINGAVERAGE_H
@@ -0,0 +1,107 @@
+#version 330 core
+// GPU LIC fragment shader: standard LIC of one texel of the LIC texture, like Lic::convolve() on the CPU
+
+uniform sampler2D velocitySampler;  // The simulation grid, (x, y) in the red and green channels.
+uniform sampler2D noiseSampler;     // The noise of the Lic object, values 0 to 255, at the output resolution.
+uniform int kernelSteps;            // Steps in each direction.
+uniform float stepSize;             // In texels.
+uniform bool rungeKutta4;           // Runge-Kutta 4 instead of Runge-Kutta 2.
+uniform vec2 fieldScale;            // Grid units per texel; the first and last grid points lie on the edges.
+uniform float fieldAspect;          // fieldScale.x / fieldScale.y
+
+out vec4 color;
+
+// The field at p (in texels), bilinearly interpolated, normalized and multiplied by orientation. Positions beyond the
+// outermost grid points take the border values. Returns false where the field vanishes.
+// Linear texture filtering uses fewer bits for the weights on many GPUs, so the texels are fetched and weighted here.
+bool direction(vec2 p, float orientation, out vec2 dir)
+{
+    ivec2 fieldDims = textureSize(velocitySampler, 0);
+    vec2 f = clamp(p * fieldScale, vec2(0.0F), vec2(fieldDims - 1));
+    ivec2 i0 = ivec2(f);
+    ivec2 i1 = min(i0 + 1, fieldDims - 1);
+    vec2 t = f - vec2(i0);
+
+    vec2 v00 = texelFetch(velocitySampler, i0, 0).rg;
+    vec2 v10 = texelFetch(velocitySampler, ivec2(i1.x, i0.y), 0).rg;
+    vec2 v01 = texelFetch(velocitySampler, ivec2(i0.x, i1.y), 0).rg;
+    vec2 v11 = texelFetch(velocitySampler, i1, 0).rg;
+    vec2 bottom = v00 + t.x * (v10 - v00);
+    vec2 top = v01 + t.x * (v11 - v01);
+    vec2 v = bottom + t.y * (top - bottom);
+    v.y *= fieldAspect;
+
+    float len = sqrt(v.x * v.x + v.y * v.y);
+    if (!(len > 1e-12F))
+        return false;
+
+    dir = v * (orientation / len);
+    return true;
+}
+
+// Moves p one step along the streamline. Returns false, leaving p unchanged, where the field vanishes.
+bool integrate(float orientation, inout vec2 p)
+{
+    float h = stepSize;
+
+    vec2 k1;
+    vec2 k2;
+    if (!direction(p, orientation, k1) || !direction(p + 0.5F * h * k1, orientation, k2))
+        return false;
+
+    if (!rungeKutta4)
+    {
+        p += h * k2;
+        return true;
+    }
+
+    vec2 k3;
+    vec2 k4;
+    if (!direction(p + 0.5F * h * k2, orientation, k3) || !direction(p + h * k3, orientation, k4))
+        return false;
+
+    p += (h / 6.0F) * (k1 + 2.0F * k2 + 2.0F * k3 + k4);
+    return true;
+}
+
+bool inside(vec2 p)
+{
+    return all(greaterThanEqual(p, vec2(0.0F))) && all(lessThan(p, vec2(textureSize(noiseSampler, 0))));
+}
+
+float noiseAt(vec2 p)
+{
+    return texelFetch(noiseSampler, ivec2(p), 0).r;
+}
+
+void main()
+{
+    // The noise values are integers, so the sum is exact in any order and matches the CPU.
+    vec2 center = gl_FragCoord.xy; // The texel center, (x + 0.5, y + 0.5).
+    float sum = noiseAt(center);
+    int count = 1;
+
+    vec2 forward = center;
+    vec2 backward = center;
+    bool forwardAlive = true;
+    bool backwardAlive = true;
+    for (int stepIdx = 0; stepIdx < kernelSteps && (forwardAlive || backwardAlive); ++stepIdx)
+    {
+        forwardAlive = forwardAlive && integrate(1.0F, forward) && inside(forward);
+        if (forwardAlive)
+        {
+            sum += noiseAt(forward);
+            ++count;
+        }
+
+        backwardAlive = backwardAlive && integrate(-1.0F, backward) && inside(backward);
+        if (backwardAlive)
+        {
+            sum += noiseAt(backward);
+            ++count;
+        }
+    }
+
+    // Truncated like the conversion to 8 bits on the CPU. Float division may be inexact in GLSL, integer division is not.
+    color = vec4(float(int(sum) / count) / 255.0F, 0.0F, 0.0F, 1.0F);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+// GPU LIC vertex shader: a full-screen quad, drawn as a triangle strip of 4 vertices without vertex data
+
+const vec2 corners[4] = vec2[4](vec2(-1.0F, -1.0F), vec2(1.0F, -1.0F), vec2(-1.0F, 1.0F), vec2(1.0F, 1.0F));
+
+void main()
+{
+    gl_Position = vec4(corners[gl_VertexID], 0.0F, 1.0F);
+}
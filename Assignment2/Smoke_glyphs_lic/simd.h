@@ -0,0 +1,31 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/* Runtime selection of the AVX2 code paths.
+ *
+ * The project is compiled for the baseline of its target, so the rest of the code runs on any x86-64 CPU and
+ * keeps the same arithmetic everywhere. Only the AVX2 kernels are compiled for AVX2 and FMA, per function with
+ * SIMD_AVX2_TARGET, and they are only called when simd::hasAvx2() reports that the CPU supports both.
+ * With other compilers or architectures SIMD_AVX2 is not defined and only the scalar code is built.
+ */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SIMD_AVX2
+#define SIMD_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+namespace simd
+{
+    // Whether the CPU can run the SIMD_AVX2_TARGET functions. Checked once.
+    inline bool hasAvx2()
+    {
+#ifdef SIMD_AVX2
+        static bool const supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#else
+        return false;
+#endif
+    }
+}
+
+#endif // SIMD_H
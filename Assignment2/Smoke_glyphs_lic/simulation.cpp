@@ -300,6 +300,26 @@ std::vector<float> Simulation::forceFieldMagnitudeInterpolated(size_t const numb
     return interpolation::interpolateSquareVector(forceFieldMagnitude(), m_DIM, numberOfRows, numberOfColumns);
 }
 
+float const *Simulation::velocityXData() const
+{
+    return m_vx.data();
+}
+
+float const *Simulation::velocityYData() const
+{
+    return m_vy.data();
+}
+
+float const *Simulation::forceFieldXData() const
+{
+    return m_fx.data();
+}
+
+float const *Simulation::forceFieldYData() const
+{
+    return m_fy.data();
+}
+
 // Note that the dimensions of m_vx and m_vy are larger than what is returned.
 // This is because the internal algorithm needs one more row and column.
 std::vector<float> Simulation::velocityMagnitude() const
@@ -64,6 +64,12 @@ public:
     std::vector<float> forceFieldXInterpolated(size_t const numberOfRows, size_t const numberOfColumns) const;
     std::vector<float> forceFieldYInterpolated(size_t const numberOfRows, size_t const numberOfColumns) const;
 
+    // The fields themselves, for reading them without a copy. The first DIM * DIM values are the row-major field.
+    float const *velocityXData() const;
+    float const *velocityYData() const;
+    float const *forceFieldXData() const;
+    float const *forceFieldYData() const;
+
     float dt() const;
     float viscosity() const;
     float rhoInjected() const;
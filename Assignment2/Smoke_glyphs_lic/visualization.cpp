@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <limits>
 #include <vector>
 
 Visualization::Visualization(QWidget *parent) : QOpenGLWidget(parent)
@@ -42,6 +43,9 @@ Visualization::~Visualization()
     glDeleteBuffers(1, &m_vaoLic);
     glDeleteBuffers(1, &m_vboLic);
     glDeleteTextures(1, &m_licTextureLocation);
+    glDeleteFramebuffers(1, &m_fboLic);
+    glDeleteTextures(1, &m_licVelocityTextureLocation);
+    glDeleteTextures(1, &m_licNoiseTextureLocation);
 
     glDeleteTextures(1, &m_scalarDataTextureLocation);
     glDeleteTextures(1, &m_vectorDataTextureLocation);
@@ -82,6 +86,7 @@ void Visualization::initializeGL() {
     createShaderProgramScalarDataClampCustomColorMap();
     createShaderProgramColorMapInstanced();
     createShaderProgramLic();
+    createShaderProgramLicGpu();
 
     // Retrieve default textures.
     auto const mainWindowPtr = qobject_cast<MainWindow*>(parent()->parent());
@@ -105,6 +110,9 @@ void Visualization::initializeGL() {
     glGenVertexArrays(1, &m_vaoLic);
     glGenBuffers(1, &m_vboLic);
     glGenTextures(1, &m_licTextureLocation);
+    glGenFramebuffers(1, &m_fboLic);
+    glGenTextures(1, &m_licVelocityTextureLocation);
+    glGenTextures(1, &m_licNoiseTextureLocation);
 
     setupAllBuffers();
 
@@ -409,6 +417,30 @@ void Visualization::createShaderProgramLic()
     qDebug() << "m_shaderProgramLic initialized.";
 }
 
+void Visualization::createShaderProgramLicGpu()
+{
+    m_shaderProgramLicGpu.addShaderFromSourceFile(QOpenGLShader::Vertex,   ":/shaders/lic_gpu.vert");
+    m_shaderProgramLicGpu.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/lic_gpu.frag");
+    m_shaderProgramLicGpu.link();
+
+    m_uniformLocationLicGpu_velocity = m_shaderProgramLicGpu.uniformLocation("velocitySampler");
+    Q_ASSERT(m_uniformLocationLicGpu_velocity != -1);
+    m_uniformLocationLicGpu_noise = m_shaderProgramLicGpu.uniformLocation("noiseSampler");
+    Q_ASSERT(m_uniformLocationLicGpu_noise != -1);
+    m_uniformLocationLicGpu_kernelSteps = m_shaderProgramLicGpu.uniformLocation("kernelSteps");
+    Q_ASSERT(m_uniformLocationLicGpu_kernelSteps != -1);
+    m_uniformLocationLicGpu_stepSize = m_shaderProgramLicGpu.uniformLocation("stepSize");
+    Q_ASSERT(m_uniformLocationLicGpu_stepSize != -1);
+    m_uniformLocationLicGpu_rungeKutta4 = m_shaderProgramLicGpu.uniformLocation("rungeKutta4");
+    Q_ASSERT(m_uniformLocationLicGpu_rungeKutta4 != -1);
+    m_uniformLocationLicGpu_fieldScale = m_shaderProgramLicGpu.uniformLocation("fieldScale");
+    Q_ASSERT(m_uniformLocationLicGpu_fieldScale != -1);
+    m_uniformLocationLicGpu_fieldAspect = m_shaderProgramLicGpu.uniformLocation("fieldAspect");
+    Q_ASSERT(m_uniformLocationLicGpu_fieldAspect != -1);
+
+    qDebug() << "m_shaderProgramLicGpu initialized.";
+}
+
 void Visualization::loadScalarDataTexture(std::vector<Color> const &colorMap)
 {
     // Set texture parameters.
@@ -453,9 +485,10 @@ void Visualization::loadLicTexture(std::vector<uint8_t> const &licTexture)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows of any width are tightly packed.
     glTexImage2D(GL_TEXTURE_2D,
                  0,
-                 GL_RED,
+                 GL_R8, // Sized, so the GPU LIC can render into it.
                  static_cast<GLint>(m_licObject.getXDim()),
                  static_cast<GLint>(m_licObject.getYDim()),
                  0,
@@ -504,129 +537,106 @@ void Visualization::resizeGL(int const width, int const height)
 
     updateScalarPoints();
     updateLicPoints();
+    updateLicResolution();
 }
 void Visualization::drawGlyphs()
 {
-    std::vector<float> vectorMagnitude;
-    std::vector<float> vectorDirectionX;
-    std::vector<float> vectorDirectionY;
+    float const *vectorFieldX = nullptr;
+    float const *vectorFieldY = nullptr;
     switch (m_currentVectorDataType)
     {
         case VectorDataType::Velocity:
-            vectorMagnitude = m_simulation.velocityMagnitudeInterpolated(m_numberOfGlyphsX, m_numberOfGlyphsY);
-            vectorDirectionX = m_simulation.velocityXInterpolated(m_numberOfGlyphsX, m_numberOfGlyphsY);
-            vectorDirectionY = m_simulation.velocityYInterpolated(m_numberOfGlyphsX, m_numberOfGlyphsY);
+            vectorFieldX = m_simulation.velocityXData();
+            vectorFieldY = m_simulation.velocityYData();
         break;
 
         case VectorDataType::ForceField:
-            vectorMagnitude = m_simulation.forceFieldMagnitudeInterpolated(m_numberOfGlyphsX, m_numberOfGlyphsY);
-            vectorDirectionX = m_simulation.forceFieldXInterpolated(m_numberOfGlyphsX, m_numberOfGlyphsY);
-            vectorDirectionY = m_simulation.forceFieldYInterpolated(m_numberOfGlyphsX, m_numberOfGlyphsY);
+            vectorFieldX = m_simulation.forceFieldXData();
+            vectorFieldY = m_simulation.forceFieldYData();
         break;
     }
 
-    // Scale the magnitudes to where these become visible.
-    std::transform(vectorMagnitude.begin(), vectorMagnitude.end(), vectorMagnitude.begin(),
-                   std::bind(std::multiplies<>(), std::placeholders::_1, m_vectorDataMagnifier));
+    size_t const numberOfInstances = m_numberOfGlyphsX * m_numberOfGlyphsY;
 
-    if (m_sendMinMaxToUI)
-    {
-        if (!vectorMagnitude.empty())
-        {
-            auto const currentMinMaxIt = std::minmax_element(vectorMagnitude.cbegin(), vectorMagnitude.cend());
-            QVector2D const currentMinMax{*currentMinMaxIt.first, *currentMinMaxIt.second};
+    // TODO: This shouldn't be here, but otherwise re-binding an already bound Glyphs VAO may cause glitches.
+    glBindVertexArray(0);
 
-            // Send values to GUI.
-            auto const mainWindowPtr = qobject_cast<MainWindow*>(parent()->parent());
-            Q_ASSERT(mainWindowPtr != nullptr);
-            mainWindowPtr->setVectorDataMin(currentMinMax.x());
-            mainWindowPtr->setVectorDataMax(currentMinMax.y());
-        }
-    }
+    // Buffering section starts here.
+    glBindVertexArray(m_vaoGlyphs);
 
-    size_t const numberOfInstances = m_numberOfGlyphsX * m_numberOfGlyphsY;
+    // The values and the model transformation matrices are written straight into their buffers while resampling.
+    // Both are mapped at once, the values through GL_COPY_WRITE_BUFFER.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vboValuesGlyphs);
+    auto * const values = static_cast<float*>(glMapBufferRange(GL_COPY_WRITE_BUFFER,
+                                                               0,
+                                                               static_cast<GLsizeiptr>(numberOfInstances * sizeof(float)),
+                                                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    glBindBuffer(GL_ARRAY_BUFFER, m_vboModelTransformationMatricesGlyphs);
+    auto * const matrices = static_cast<float*>(glMapBufferRange(GL_ARRAY_BUFFER,
+                                                                 0,
+                                                                 static_cast<GLsizeiptr>(numberOfInstances * 16U * sizeof(float)),
+                                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
 
-    std::vector<float> modelTransformationMatrices;
-    /* Fill the container modelTransformationMatrices here...
-     * Use the following variables:
-     * modelTransformationMatrix: This vector should contain the result.
-     * m_DIM: The grid dimensions of the simulation.
-     * m_cellWidth, m_cellHeight: A cell, made up of 4 simulation grid points, has the size m_cellWidth * m_cellHeight for the visualization.
-     * m_numberOfGlyphsX (horizontal)
-     * m_numberOfGlyphsY (vertical)
-     * m_glyphCellWidth, m_glyphCellHeight: Use these as a small offset from the border of the OpenGL window.
-     *                                      Having this little border around the visualization prevents a left-pointing arrow
-     *                                      on the left side of the window to become invisible and thus convey no information.
-     * vectorDirectionX, vectorDirectionY: To which direction the glyph should point. Row-major, size given by the m_numberOfGlyphs*.
-     * vectorMagnitude: Use this value to scale the glyphs. I.e. higher values are visualized using larger glyphs. Row-major, size given by the m_numberOfGlyphs*.
-     */
-
-    modelTransformationMatrices = std::vector<float>(numberOfInstances * 16U, 0.0F); // Remove this placeholder initialization
-
-    float const pi = 3.14159F;
-    float const cellWidth = static_cast<float>(m_DIM) / static_cast<float>(m_numberOfGlyphsX) * m_cellWidth;
-    float const cellHeight = static_cast<float>(m_DIM) / static_cast<float>(m_numberOfGlyphsY) * m_cellHeight;
-
-    for(size_t x = 0; x < m_numberOfGlyphsX; ++x)
+    if (values != nullptr && matrices != nullptr)
     {
-        for(size_t y = 0; y < m_numberOfGlyphsY; ++y)
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = std::numeric_limits<float>::lowest();
+
+        // Glyph (x, y) is drawn at ((x + 1), (y + 1)) * glyph cell size, which is where the resampler samples it.
+        // Its magnitude is that of the sampled vector, scaled to where it becomes visible.
+        m_glyphResampler.setSizes(m_DIM, m_numberOfGlyphsX, m_numberOfGlyphsY);
+        m_glyphResampler.resampleVector(vectorFieldX, vectorFieldY,
+                                        [&](size_t const y, float const *rowX, float const *rowY)
         {
-            size_t index = m_numberOfGlyphsX * y + x;
-
-//            QMatrix4x4 matrix = QMatrix4x4(); // Constructs an identity matrix
+            float const translationY = m_glyphCellHeight * static_cast<float>(y + 1U);
+            float * const valueRow = values + m_numberOfGlyphsX * y;
+            float *matrix = matrices + 16U * m_numberOfGlyphsX * y;
 
-            // Perform transformations: scaling, translation and rotation.
-
-            // For a rotation of angle theta counter-clockwise, the transformation matrix should be:
-            // cos(theta)   -sin(theta)  0   0
-            // sin(theta)   cost(theta)  0   0
-            // 0            0            1   0
-            // 0            0            0   1
-            float theta = atan(vectorDirectionY[index] / vectorDirectionX[index]) - 0.5 * pi; // tan = opposite / adjacent
-            if (vectorDirectionX[index] < 0) // Account for the fact that the result of atan in [-pi/2, pi/2] and ignores negative x
+            for (size_t x = 0U; x < m_numberOfGlyphsX; ++x, matrix += 16U)
             {
-                theta = theta + pi; // Now in [pi/2, 3/2*pi]
+                float const vx = m_vectorDataMagnifier * rowX[x];
+                float const vy = m_vectorDataMagnifier * rowY[x];
+                float const magnitude = std::sqrt(vx * vx + vy * vy);
+                valueRow[x] = magnitude;
+                minimum = std::min(minimum, magnitude);
+                maximum = std::max(maximum, magnitude);
+
+                // Column-major: the rotation by theta that turns the upward-pointing glyph to (vx, vy), scaled by
+                // m_vec_scale * magnitude, then translated. Since cos(theta) = vy / magnitude and
+                // sin(theta) = -vx / magnitude, the magnitude cancels out of the rotation part.
+                matrix[0] = m_vec_scale * vy;
+                matrix[1] = -m_vec_scale * vx;
+                matrix[2] = 0.0F;
+                matrix[3] = 0.0F;
+                matrix[4] = m_vec_scale * vx;
+                matrix[5] = m_vec_scale * vy;
+                matrix[6] = 0.0F;
+                matrix[7] = 0.0F;
+                matrix[8] = 0.0F;
+                matrix[9] = 0.0F;
+                matrix[10] = m_vec_scale * magnitude;
+                matrix[11] = 0.0F;
+                matrix[12] = m_glyphCellWidth * static_cast<float>(x + 1U);
+                matrix[13] = translationY;
+                matrix[14] = 0.0F;
+                matrix[15] = 1.0F;
             }
-            QMatrix4x4 matrix = QMatrix4x4(cos(theta), -sin(theta), 0, 0,
-                                           sin(theta), cos(theta),  0, 0,
-                                           0,          0,           1, 0,
-                                           0,          0,           0, 1);
-//            matrix.rotate(theta / pi * 180.0F, 1.0F, 1.0F, 0.0F);
-
-            // Scaling
-            matrix.scale(1000 * vectorMagnitude[index]);
-
-            // Translation
-            QMatrix4x4 translation = QMatrix4x4(0, 0, 0, m_glyphCellWidth + cellWidth * (static_cast<float>(x) + 0.5F),
-                                                0, 0, 0, m_glyphCellHeight + cellHeight * (static_cast<float>(y) + 0.5F),
-                                                0, 0, 0, 0,
-                                                0, 0, 0, 0);
-            matrix += translation;
-//            matrix.translate(m_glyphCellWidth + cellWidth * (static_cast<float>(x) + 0.5F), m_glyphCellHeight + cellHeight * (static_cast<float>(y) + 0.5F));
-
-            // Store matrix in modelTransformationMatrices
-            std::vector<float> dat = std::vector<float> { matrix.data(), matrix.data() + 16U};
-            std::copy(dat.begin(), dat.end(), modelTransformationMatrices.begin() + index * 16U);
+        });
+
+        if (m_sendMinMaxToUI && numberOfInstances > 0U)
+        {
+            // Send values to GUI.
+            auto const mainWindowPtr = qobject_cast<MainWindow*>(parent()->parent());
+            Q_ASSERT(mainWindowPtr != nullptr);
+            mainWindowPtr->setVectorDataMin(minimum);
+            mainWindowPtr->setVectorDataMax(maximum);
         }
     }
 
-    // TODO: This shouldn't be here, but otherwise re-binding an already bound Glyphs VAO may cause glitches.
-    glBindVertexArray(0);
-
-    // Buffering section starts here.
-    glBindVertexArray(m_vaoGlyphs);
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboValuesGlyphs);
-    glBufferSubData(GL_ARRAY_BUFFER,
-                    0,
-                    static_cast<GLsizeiptr>(vectorMagnitude.size() * sizeof(float)),
-                    vectorMagnitude.data());
-
-    // Buffer model transformation matrices.
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboModelTransformationMatricesGlyphs);
-    void * const dataPtr = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-    memcpy(dataPtr, modelTransformationMatrices.data(), modelTransformationMatrices.size() * sizeof(float));
-    glUnmapBuffer(GL_ARRAY_BUFFER);
+    if (matrices != nullptr)
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    if (values != nullptr)
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
 
     if (m_currentGlyphType == Glyph::GlyphType::Hedgehog)
         glDrawElementsInstanced(GL_LINES,
@@ -699,6 +709,17 @@ void Visualization::updateLicPoints()
                     licCoordsAndTexCoords.data());
 }
 
+void Visualization::updateLicResolution()
+{
+    // The LIC quad spans m_DIM - 1 cells in both directions, see updateLicPoints().
+    unsigned int resolution = m_licFixedResolution;
+    if (m_licMatchWindow)
+        resolution = std::max(1U, static_cast<unsigned int>(std::lround(static_cast<float>(m_DIM - 1U) * m_cellWidth)));
+
+    if (resolution != m_licObject.getXDim() || resolution != m_licObject.getYDim())
+        m_licObject.resetTexture(resolution, resolution);
+}
+
 void Visualization::drawScalarData()
 {
     std::vector<float> scalarValues;
@@ -916,16 +937,19 @@ void Visualization::setNumberOfGlyphsY(size_t const numberOfGlyphsY)
 
 void Visualization::drawLic()
 {
-    std::vector<float> vectorField_in_x;
-    std::vector<float> vectorField_in_y;
-    vectorField_in_x = m_simulation.velocityXInterpolated(m_licObject.getXDim(), m_licObject.getYDim()); // These should get the force field vectors of size equal to the simulation area, if I understand the function correctly?
-    vectorField_in_y = m_simulation.velocityYInterpolated(m_licObject.getXDim(), m_licObject.getYDim());
-
     //m_licObject.resetTexture(); // Uncomment this line if you want the noise texture to look like its "Flowing".
 
-    std::vector<float> texture_in = m_licObject.getTexture();
-
-    std::vector<uint8_t> texture_out = m_licObject.updateTexture(vectorField_in_x, vectorField_in_y, texture_in); //Generate the texture to be sent to openGL
+    if (m_licOnGpu)
+    {
+        computeLicOnGpu(); // Renders straight into m_licTextureLocation.
+    }
+    else
+    {
+        m_licObject.setAdvectionTimeStep(m_simulation.dt()); // One frame of texture advection per simulation step.
+        m_licObject.updateTexture(m_simulation.velocityXData(), m_simulation.velocityYData(),
+                                  static_cast<unsigned int>(m_DIM), static_cast<unsigned int>(m_DIM),
+                                  m_licTexture); //Generate the texture to be sent to openGL
+    }
 
     m_shaderProgramLic.bind();
     glUniformMatrix4fv(m_uniformLocationLic_projection, 1, GL_FALSE, m_projectionTransformationMatrix.data());
@@ -934,8 +958,109 @@ void Visualization::drawLic()
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, m_licTextureLocation);
 
-    loadLicTexture(texture_out);
+    if (!m_licOnGpu)
+        loadLicTexture(m_licTexture);
 
     glBindVertexArray(m_vaoLic);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
+
+// Standard LIC in a fragment shader that renders one fragment per texel of the LIC texture. Only the m_DIM x m_DIM velocity
+// is uploaded every frame; the noise only when m_licObject generates new noise, which also resizes the output texture.
+// Lic::Algorithm::Standard on the CPU does the same arithmetic, so it serves as the reference without a GPU.
+void Visualization::computeLicOnGpu()
+{
+    GLint const dimX = static_cast<GLint>(m_licObject.getXDim());
+    GLint const dimY = static_cast<GLint>(m_licObject.getYDim());
+    GLint const fieldDim = static_cast<GLint>(m_DIM);
+
+    float const *velocityX = m_simulation.velocityXData();
+    float const *velocityY = m_simulation.velocityYData();
+    m_licVelocity.resize(2U * m_DIM * m_DIM);
+    for (size_t idx = 0U; idx < m_DIM * m_DIM; ++idx)
+    {
+        m_licVelocity[2U * idx] = velocityX[idx];
+        m_licVelocity[2U * idx + 1U] = velocityY[idx];
+    }
+
+    bool const noiseChanged = m_licNoiseVersionOnGpu != m_licObject.getNoiseVersion();
+    m_licNoiseVersionOnGpu = m_licObject.getNoiseVersion();
+
+    glActiveTexture(GL_TEXTURE0);
+    if (noiseChanged)
+        loadLicTexture(std::vector<uint8_t>()); // Allocates the output texture at the current size.
+
+    // The shader fetches texels directly, so filtering only needs to be set to keep the textures complete.
+    glBindTexture(GL_TEXTURE_2D, m_licVelocityTextureLocation);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, fieldDim, fieldDim, 0, GL_RG, GL_FLOAT, m_licVelocity.data());
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_licNoiseTextureLocation);
+    if (noiseChanged)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, dimX, dimY, 0, GL_RED, GL_FLOAT, m_licObject.getTexture().data());
+    }
+
+    std::array<GLint, 4> viewport;
+    glGetIntegerv(GL_VIEWPORT, viewport.data());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fboLic);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_licTextureLocation, 0);
+    glViewport(0, 0, dimX, dimY);
+
+    m_shaderProgramLicGpu.bind();
+    glUniform1i(m_uniformLocationLicGpu_velocity, 0);
+    glUniform1i(m_uniformLocationLicGpu_noise, 1);
+    glUniform1i(m_uniformLocationLicGpu_kernelSteps, static_cast<GLint>(m_licObject.getKernelSteps()));
+    glUniform1f(m_uniformLocationLicGpu_stepSize, Lic::STEP_SIZE);
+    glUniform1i(m_uniformLocationLicGpu_rungeKutta4, m_licObject.getIntegrationMethod() == Lic::IntegrationMethod::RungeKutta4);
+
+    // Computed here like in Lic, since the shader's division need not be exact.
+    float const fieldScaleX = Lic::fieldScale(static_cast<unsigned int>(m_DIM), m_licObject.getXDim());
+    float const fieldScaleY = Lic::fieldScale(static_cast<unsigned int>(m_DIM), m_licObject.getYDim());
+    glUniform2f(m_uniformLocationLicGpu_fieldScale, fieldScaleX, fieldScaleY);
+    glUniform1f(m_uniformLocationLicGpu_fieldAspect, fieldScaleX / fieldScaleY);
+
+    // The vertex shader makes a full-screen quad by itself; the VAO is only bound because the core profile needs one.
+    glBindVertexArray(m_vaoLic);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+#ifndef QT_NO_DEBUG
+    if (noiseChanged)
+        checkLicOnGpu();
+#endif
+}
+
+#ifndef QT_NO_DEBUG
+// Debug builds compare the first GPU LIC frame after every noise change with Lic::Algorithm::Standard on the CPU, for
+// the same field and noise. Both do the same arithmetic, so any difference means the shader and Lic have drifted apart.
+void Visualization::checkLicOnGpu()
+{
+    Lic reference = m_licObject;
+    reference.setAlgorithm(Lic::Algorithm::Standard);
+    reference.setContrastEnhancement(Lic::ContrastEnhancement::None);
+    std::vector<uint8_t> expected;
+    reference.updateTexture(m_simulation.velocityXData(), m_simulation.velocityYData(),
+                            static_cast<unsigned int>(m_DIM), static_cast<unsigned int>(m_DIM), expected);
+
+    std::vector<uint8_t> rendered(expected.size());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_licTextureLocation);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, rendered.data());
+
+    size_t mismatches = 0U;
+    for (size_t idx = 0U; idx < rendered.size(); ++idx)
+        mismatches += rendered[idx] != expected[idx] ? 1U : 0U;
+
+    if (mismatches > 0U)
+        qDebug() << "GPU LIC differs from the CPU reference in" << mismatches << "of" << rendered.size() << "texels.";
+}
+#endif
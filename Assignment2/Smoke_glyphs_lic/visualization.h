@@ -4,6 +4,7 @@
 #include "color.h"
 #include "datatype.h"
 #include "glyph.h"
+#include "interpolation.h"
 #include "movingaverage.h"
 #include "simulation.h"
 #include "texture.h"
@@ -46,6 +47,8 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     bool m_drawScalarData = true;   // Draw the smoke or not.
     bool m_drawVectorData = false;  // Draw the vector field or not.
     bool m_drawLIC = false;         // Draw LIC or not.
+    bool m_licOnGpu = false;        // Compute standard LIC in a fragment shader instead of with m_licObject.
+    bool m_licMatchWindow = false;  // Give the LIC texture one texel per pixel of the LIC quad instead of a fixed size.
     size_t m_DIM = 64U;             // Size of simulation grid. Must be even.
 
     float m_cellWidth;		        // Grid cell width
@@ -77,9 +80,14 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     float m_glyphCellWidth;
     float m_glyphCellHeight;
     float m_vec_scale = 1000.0F;    									// Glyph scaling factor.
+    interpolation::SquareResampler m_glyphResampler;                    // Samples the vector field at the glyphs.
 
     // LIC info
-    Lic m_licObject = Lic(256, 256);
+    unsigned int const m_licFixedResolution = 256U;
+    Lic m_licObject = Lic(m_licFixedResolution, m_licFixedResolution);
+    std::vector<uint8_t> m_licTexture;      // LIC output, reused between frames.
+    std::vector<float> m_licVelocity;       // GPU LIC: the velocity interleaved as (x, y) pairs.
+    unsigned int m_licNoiseVersionOnGpu = 0U; // GPU LIC: m_licObject's noise version in m_licNoiseTextureLocation.
 
     void drag(int const mx, int my);
 
@@ -98,6 +106,9 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     GLuint m_vaoLic;
     GLuint m_vboLic;
     GLuint m_licTextureLocation;
+    GLuint m_fboLic;
+    GLuint m_licVelocityTextureLocation;
+    GLuint m_licNoiseTextureLocation;
 
     QOpenGLShaderProgram m_shaderProgramScalarDataScaleTexture;
     QOpenGLShaderProgram m_shaderProgramScalarDataScaleCustomColorMap;
@@ -105,6 +116,7 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     QOpenGLShaderProgram m_shaderProgramScalarDataClampCustomColorMap;
     QOpenGLShaderProgram m_shaderProgramVectorData;
     QOpenGLShaderProgram m_shaderProgramLic;
+    QOpenGLShaderProgram m_shaderProgramLicGpu;
 
     GLint m_uniformLocationScalarDataScaleTexture_rangeMin;
     GLint m_uniformLocationScalarDataScaleTexture_rangeMax;
@@ -140,6 +152,14 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 
     GLint m_uniformLocationLicTexture;
 
+    GLint m_uniformLocationLicGpu_velocity;
+    GLint m_uniformLocationLicGpu_noise;
+    GLint m_uniformLocationLicGpu_kernelSteps;
+    GLint m_uniformLocationLicGpu_stepSize;
+    GLint m_uniformLocationLicGpu_rungeKutta4;
+    GLint m_uniformLocationLicGpu_fieldScale;
+    GLint m_uniformLocationLicGpu_fieldAspect;
+
     QMatrix4x4 m_projectionTransformationMatrix;
     QMatrix4x4 m_viewTransformationMatrix;
 
@@ -157,6 +177,7 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
     void createShaderProgramScalarDataClampCustomColorMap();
     void createShaderProgramColorMapInstanced();
     void createShaderProgramLic();
+    void createShaderProgramLicGpu();
 
     void loadScalarDataTexture(std::vector<Color> const &colorMap);
     void loadVectorDataTexture(std::vector<Color> const &colorMap);
@@ -174,7 +195,12 @@ class Visualization : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 
     void setupLic();
     void updateLicPoints();
+    void updateLicResolution();
     void drawLic();
+    void computeLicOnGpu();
+#ifndef QT_NO_DEBUG
+    void checkLicOnGpu();
+#endif
 
 protected:
     void initializeGL();